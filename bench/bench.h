@@ -0,0 +1,90 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * shared helpers of the 'make bench' drivers (header only, one driver per
+ * executable): wall clock timer, page cache eviction and a one line report
+ * format, inputs come from 'tests/fixture.h'; every driver compares a code
+ * path against its baseline on the same input
+ */
+
+#ifndef _FLOTT_BENCH_H_
+#define _FLOTT_BENCH_H_
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../flott.h"
+#include "../flott_util.h"
+#include "../tests/fixture.h"
+
+/**
+ * monotonic wall clock in seconds
+ */
+static inline double
+bench_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**
+ * drop the cached pages of 'path' (no-op where fadvise is missing)
+ */
+static inline void
+bench_evict (const char *path)
+{
+#ifdef POSIX_FADV_DONTNEED
+  int fd = open (path, O_RDONLY);
+
+  if (fd >= 0)
+    {
+      fdatasync (fd); ///< dirty pages are not dropped
+      posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+      close (fd);
+    }
+#else
+  (void) path;
+#endif
+}
+
+/**
+ * print a 'name: rate unit (seconds)' line, plus the speed-up over
+ * 'baseline_rate' when that is non-zero
+ */
+static inline void
+bench_report (const char *name, double rate, const char *unit,
+              double seconds, double baseline_rate)
+{
+  printf ("  %-34s %12.1f %s  (%.3f s)", name, rate, unit, seconds);
+  if (baseline_rate > 0.0)
+    {
+      printf ("  x%.2f", rate / baseline_rate);
+    }
+  printf ("\n");
+}
+
+#endif /* _FLOTT_BENCH_H_ */
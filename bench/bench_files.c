@@ -0,0 +1,185 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * copy pattern writes over many small concatenated files: a linear walk
+ * back from the last member plus fopen/fseek/fread/fclose per pattern
+ * (baseline, the scheme 'flott_input_write' replaced) against
+ * 'flott_input_write' on file sources and on loaded sources, with patterns
+ * visited right-to-left as the transform does and in random order
+ *
+ * usage: bench_files [files]
+ */
+
+#include "bench.h"
+
+#define BENCH_WRITES 200000
+#define BENCH_MAX_PATTERN 64
+
+static void
+bench_reopen_write (flott_object *op, size_t start_offset, size_t count,
+                    FILE *output_handle)
+{
+  char buffer[BENCH_MAX_PATTERN];
+  flott_source *source;
+  size_t member = op->input.count - 1, length;
+  FILE *handle;
+
+  while (op->input.source[member].start_offset > start_offset)
+    {
+      member--;
+    }
+  while (count > 0)
+    {
+      source = &(op->input.source[member++]);
+      length = source->end_offset - start_offset;
+      length = (count < length) ? count : length;
+      handle = fopen (source->path, "rb");
+      if (handle != NULL)
+        {
+          fseek (handle, (long) (start_offset - source->start_offset),
+                 SEEK_SET);
+          fwrite (buffer, 1, fread (buffer, 1, length, handle),
+                  output_handle);
+          fclose (handle);
+        }
+      start_offset += length;
+      count -= length;
+    }
+}
+
+/**
+ * 'BENCH_WRITES' copy patterns of 1 to 'BENCH_MAX_PATTERN' bytes, written
+ * to memory through the baseline or 'flott_input_write'
+ */
+static double
+bench_writes (flott_object *op, int random, int baseline, char **text,
+              size_t *text_length)
+{
+  size_t length = op->input.length - 1; ///< without the stop symbol
+  size_t offset = length, count, i;
+  unsigned int state = 17;
+  FILE *output = open_memstream (text, text_length);
+  double seconds = bench_now ();
+
+  for (i = 0; i < BENCH_WRITES; i++)
+    {
+      state = state * 1103515245u + 12345u;
+      count = 1 + (state >> 16) % BENCH_MAX_PATTERN;
+      if (random)
+        {
+          state = state * 1103515245u + 12345u;
+          offset = (size_t) ((double) (state >> 8) / (double) (1u << 24)
+                             * (double) (length - count));
+        }
+      else
+        {
+          offset = (offset < count) ? length - count : offset - count;
+        }
+      if (baseline)
+        {
+          bench_reopen_write (op, offset, count, output);
+        }
+      else
+        {
+          flott_input_write (op, offset, count, output);
+        }
+    }
+  fclose (output);
+  return bench_now () - seconds;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *name[] = { "reopen per pattern", "file sources",
+                                "loaded sources" };
+  static const flott_storage_type storage[] = { FLOTT_DEV_FILE,
+                                                FLOTT_DEV_FILE,
+                                                FLOTT_DEV_FILE_TO_MEM };
+  size_t files = (argc > 1) ? (size_t) atol (argv[1]) : 10000;
+  char **path = (char **) malloc (files * sizeof (char *));
+  char *data, *text[3], label[64];
+  size_t text_length[3], i, length, total = 0;
+  flott_object *op;
+  double seconds[3];
+  int random, variant;
+
+  for (i = 0; i < files; i++) ///< 200 to 1800 bytes each
+    {
+      length = 200 + (i * 7919) % 1600;
+      data = fixture_make_input (length, (unsigned int) i);
+      path[i] = fixture_make_file (data, length);
+      total += length;
+      free (data);
+    }
+
+  printf ("copy pattern writes: %zu files, %zu bytes, %d patterns\n", files,
+          total, BENCH_WRITES);
+  for (random = 0; random < 2; random++)
+    {
+      for (variant = 0; variant < 3; variant++)
+        {
+          op = flott_create_instance (files);
+          memset (op->input.source, 0, files * sizeof (flott_source));
+          op->input.deallocate = true; ///< loaded sources, handles
+          for (i = 0; i < files; i++)
+            {
+              op->input.source[i].storage_type = storage[variant];
+              op->input.source[i].path = path[i];
+              op->input.source[i].length = flott_get_file_size (path[i]);
+            }
+          if (flott_initialize (op) != FLOTT_SUCCESS)
+            {
+              fprintf (stderr, "initialization failed\n");
+              return 1;
+            }
+          seconds[variant] = bench_writes (op, random, variant == 0,
+                                           &text[variant],
+                                           &text_length[variant]);
+          flott_destroy (op);
+
+          sprintf (label, "%s, %s", random ? "random" : "right-to-left",
+                   name[variant]);
+          bench_report (label, BENCH_WRITES / seconds[variant], "patterns/s",
+                        seconds[variant], (variant == 0)
+                                          ? 0.0 : BENCH_WRITES / seconds[0]);
+        }
+      for (variant = 0; variant < 3; variant++)
+        {
+          if (text_length[variant] != text_length[0]
+              || memcmp (text[variant], text[0], text_length[0]) != 0)
+            {
+              fprintf (stderr, "%s: written patterns differ\n", name[variant]);
+              return 1;
+            }
+        }
+      for (variant = 0; variant < 3; variant++)
+        {
+          free (text[variant]);
+        }
+    }
+
+  for (i = 0; i < files; i++)
+    {
+      unlink (path[i]);
+      free (path[i]);
+    }
+  free (path);
+  return 0;
+}
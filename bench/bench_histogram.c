@@ -0,0 +1,211 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * copy factor accumulation: the copy factors of a transform are recorded,
+ * then summed step by step through 'flott_log2_M' (baseline) and counted
+ * in a histogram summed once at the end, as the engine does; the
+ * second part times whole transforms of the histogram-only instance against
+ * the boundary instance, which keeps the running sum per step
+ *
+ * usage: bench_histogram [length]
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "../flott_math.h"
+
+#define BENCH_PASSES 50
+#define BENCH_RUNS 3
+
+typedef struct bench_stream bench_stream;
+
+struct bench_stream
+{
+  size_t *copy_factor;
+  size_t length;
+  size_t capacity;
+};
+
+static void
+bench_record (flott_object *op, const flott_step_record *record,
+              const size_t count, int *terminate)
+{
+  bench_stream *stream = (bench_stream *) op->user;
+  size_t i;
+
+  (void) terminate;
+  if (stream->length + count > stream->capacity)
+    {
+      stream->capacity = 2 * (stream->length + count);
+      stream->copy_factor = (size_t *)
+          realloc (stream->copy_factor, stream->capacity * sizeof (size_t));
+    }
+  for (i = 0; i < count; i++)
+    {
+      stream->copy_factor[stream->length++] = record[i].copy_factor;
+    }
+}
+
+static double
+bench_per_step (const bench_stream *stream)
+{
+  double t_complexity = 0.0;
+  size_t i;
+
+  for (i = 0; i < stream->length; i++)
+    {
+      t_complexity += flott_log2_M (stream->copy_factor[i] + 1);
+    }
+  return t_complexity;
+}
+
+static double
+bench_histogram (const bench_stream *stream)
+{
+  size_t cf_histogram[FLOTT_CF_HISTOGRAM_SIZE] = {0};
+  double t_complexity = 0.0;
+  size_t i, cf_value;
+
+  for (i = 0; i < stream->length; i++)
+    {
+      cf_value = stream->copy_factor[i];
+      if (cf_value < FLOTT_CF_HISTOGRAM_SIZE)
+        {
+          cf_histogram[cf_value]++;
+        }
+      else
+        {
+          t_complexity += flott_log2_M (cf_value + 1);
+        }
+    }
+  for (i = 1; i < FLOTT_CF_HISTOGRAM_SIZE; i++)
+    {
+      t_complexity += cf_histogram[i] * flott_log2_M (i + 1);
+    }
+  return t_complexity;
+}
+
+/**
+ * time 'BENCH_PASSES' passes of 'sum' over the stream, best of three
+ */
+static double
+bench_passes (double (*sum) (const bench_stream *),
+              const bench_stream *stream, double *t_complexity)
+{
+  double best = 0.0, seconds;
+  int run, pass;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      seconds = bench_now ();
+      for (pass = 0; pass < BENCH_PASSES; pass++)
+        {
+          *t_complexity = sum (stream);
+        }
+      seconds = bench_now () - seconds;
+      best = (run == 0 || seconds < best) ? seconds : best;
+    }
+  return best;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *input_name[] = { "text", "runs" };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (8u << 20);
+  flott_step_record records[4096];
+  bench_stream stream;
+  flott_object *op;
+  double seconds, baseline, expected, actual, best[2];
+  char *data[2], name[64];
+  size_t i;
+  int input, variant, run;
+
+  /* text, and text broken up by runs of 40 to 4000 equal bytes */
+  data[0] = fixture_make_input (length, 5);
+  data[1] = fixture_make_input (length, 6);
+  for (i = 0; i + 8192 < length; i += 8192)
+    {
+      memset (data[1] + i, ' ', 40 + (i / 8192) % 4000);
+    }
+
+  printf ("copy factor accumulation: %zu bytes, %d passes, best of %d\n",
+          length, BENCH_PASSES, BENCH_RUNS);
+  for (input = 0; input < 2; input++)
+    {
+      memset (&stream, 0, sizeof (stream));
+      op = fixture_make_object (FLOTT_DEV_MEM, data[input], length, NULL);
+      op->user = &stream;
+      op->handler.record = &bench_record;
+      op->step_buffer.record = records;
+      op->step_buffer.size = sizeof (records) / sizeof (records[0]);
+      flott_initialize (op);
+      flott_t_transform_policy (op, FLOTT_OBSERVE_RECORD);
+      flott_destroy (op);
+
+      seconds = bench_passes (&bench_per_step, &stream, &expected);
+      baseline = BENCH_PASSES * stream.length / seconds / 1e6;
+      sprintf (name, "%s, per step log2", input_name[input]);
+      bench_report (name, baseline, "Msteps/s", seconds, 0.0);
+      seconds = bench_passes (&bench_histogram, &stream, &actual);
+      sprintf (name, "%s, histogram", input_name[input]);
+      bench_report (name, BENCH_PASSES * stream.length / seconds / 1e6,
+                    "Msteps/s", seconds, baseline);
+      if (fabs (actual - expected) > 1e-9 * expected) return 1;
+      free (stream.copy_factor);
+    }
+
+  printf ("t-transform: running sum against histogram only\n");
+  for (input = 0; input < 2; input++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data[input], length, NULL);
+      for (variant = 0; variant < 2; variant++)
+        {
+          for (run = 0; run < BENCH_RUNS; run++)
+            {
+              flott_initialize (op);
+              seconds = bench_now ();
+              if (variant == 0)
+                {
+                  op->boundary.offset = 0;
+                  flott_t_transform_policy (op, FLOTT_OBSERVE_BOUNDARY);
+                }
+              else
+                {
+                  flott_t_transform_policy (op, FLOTT_OBSERVE_NONE);
+                }
+              seconds = bench_now () - seconds;
+              best[variant] = (run == 0 || seconds < best[variant])
+                              ? seconds : best[variant];
+              flott_deinitialize (op);
+            }
+          sprintf (name, "%s, %s", input_name[input],
+                   (variant == 0) ? "running sum" : "histogram only");
+          bench_report (name, length / best[variant] / 1e6, "MB/s",
+                        best[variant], (variant == 0)
+                                       ? 0.0 : length / best[0] / 1e6);
+        }
+      flott_destroy (op);
+    }
+
+  free (data[1]);
+  free (data[0]);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * token workspace backing: a t-transform on a workspace from plain 'malloc'
+ * lent through 'flott_set_workspace' (baseline) against the workspace
+ * 'flott_initialize' allocates itself, which is backed by huge pages where
+ * available (see 'flott_alloc_workspace'); initialization (page faults of
+ * the fresh workspace) and transform are timed separately
+ *
+ * usage: bench_hugepage [length]
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "../flott_lang.h"
+
+#define BENCH_RUNS 3
+
+/**
+ * initialize and transform 'data', on a malloc'ed workspace if 'heap',
+ * best of three runs each
+ */
+static void
+bench_transform (char *data, size_t length, int heap, double *initialize,
+                 double *transform, double *t_complexity,
+                 flott_backing *backing)
+{
+  size_t size = flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE);
+  flott_object *op;
+  void *workspace;
+  double seconds;
+  int run;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      workspace = NULL;
+      if (heap)
+        {
+          workspace = malloc (size);
+          flott_set_workspace (op, workspace, size);
+        }
+      seconds = bench_now ();
+      if (flott_initialize (op) != FLOTT_SUCCESS)
+        {
+          fprintf (stderr, "initialization failed\n");
+          exit (1);
+        }
+      seconds = bench_now () - seconds;
+      *initialize = (run == 0 || seconds < *initialize) ? seconds
+                                                        : *initialize;
+      *backing = flott_get_workspace_backing (op);
+      seconds = bench_now ();
+      flott_t_transform (op);
+      seconds = bench_now () - seconds;
+      *transform = (run == 0 || seconds < *transform) ? seconds : *transform;
+      *t_complexity = op->result.t_complexity;
+      flott_destroy (op);
+      free (workspace);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *name[] = { "malloc", "flott_alloc_workspace" };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (16u << 20);
+  char *data = fixture_make_input (length, 9);
+  double initialize[2], transform[2], t_complexity[2];
+  flott_backing backing;
+  int variant;
+
+  printf ("workspace backing: %zu bytes, %zu byte workspace, best of %d\n",
+          length, flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE),
+          BENCH_RUNS);
+  for (variant = 0; variant < 2; variant++)
+    {
+      bench_transform (data, length, variant == 0, &initialize[variant],
+                       &transform[variant], &t_complexity[variant], &backing);
+      printf ("  %s (%s)\n", name[variant], flott_backing_lut_G[backing]);
+      bench_report ("  initialize", length / initialize[variant] / 1e6,
+                    "MB/s", initialize[variant], (variant == 0)
+                    ? 0.0 : length / initialize[0] / 1e6);
+      bench_report ("  t-transform", length / transform[variant] / 1e6,
+                    "MB/s", transform[variant], (variant == 0)
+                    ? 0.0 : length / transform[0] / 1e6);
+    }
+  if (fabs (t_complexity[1] - t_complexity[0]) > 1e-9 * t_complexity[0])
+    {
+      fprintf (stderr, "t-complexities differ\n");
+      return 1;
+    }
+
+  free (data);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * input storage types: level-zero initialization and random copy pattern
+ * writes for file (baseline), file-to-memory and memory mapped sources,
+ * with the page cache dropped ('cold') and populated ('warm')
+ *
+ * usage: bench_io [length]
+ */
+
+#include "bench.h"
+
+#define BENCH_WRITES 100000     ///< random copy pattern writes
+#define BENCH_PATTERN 64        ///< copy pattern length in bytes
+
+int
+main (int argc, char **argv)
+{
+  static const flott_storage_type storage[] = { FLOTT_DEV_FILE,
+                                                FLOTT_DEV_FILE_TO_MEM,
+                                                FLOTT_DEV_MMAP };
+  static const char *storage_name[] = { "file", "file to memory", "mmap" };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (64u << 20);
+  char *data = fixture_make_input (length, 5);
+  char *path = fixture_make_file (data, length);
+  FILE *sink = fopen ("/dev/null", "wb");
+  double init[2][3], write[2][3], seconds;
+  flott_object *op;
+  int cold, i, k;
+  char name[64];
+
+  if (length <= BENCH_PATTERN || sink == NULL) return 1;
+  free (data);
+  printf ("input storage: %zu bytes, %d random %d byte copy pattern writes\n",
+          length, BENCH_WRITES, BENCH_PATTERN);
+  for (cold = 1; cold >= 0; cold--)
+    {
+      for (i = 0; i < 3; i++)
+        {
+          op = fixture_make_object (storage[i], NULL, length, path);
+          if (cold)
+            {
+              bench_evict (path);
+            }
+          else
+            {
+              flott_initialize (op);    ///< populate cache and mapping
+            }
+          seconds = bench_now ();
+          flott_initialize (op);
+          init[cold][i] = bench_now () - seconds;
+
+          if (cold)
+            {
+              bench_evict (path);
+            }
+          srand (1);
+          seconds = bench_now ();
+          for (k = 0; k < BENCH_WRITES; k++)
+            {
+              flott_input_write (op, (size_t) rand () % (length - BENCH_PATTERN),
+                                 BENCH_PATTERN, sink);
+            }
+          write[cold][i] = bench_now () - seconds;
+          flott_destroy (op);
+
+          sprintf (name, "%s, %s, init", storage_name[i],
+                   cold ? "cold" : "warm");
+          bench_report (name, length / init[cold][i] / 1e6, "MB/s",
+                        init[cold][i], (i == 0) ? 0.0
+                                                : length / init[cold][0] / 1e6);
+          sprintf (name, "%s, %s, writes", storage_name[i],
+                   cold ? "cold" : "warm");
+          bench_report (name, BENCH_WRITES / write[cold][i], "writes/s",
+                        write[cold][i], (i == 0) ? 0.0
+                                                 : BENCH_WRITES / write[cold][0]);
+        }
+    }
+
+  fclose (sink);
+  unlink (path);
+  free (path);
+  return 0;
+}
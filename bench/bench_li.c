@@ -0,0 +1,96 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * inverse logarithmic integral: the iterative solver 'flott_get_t_information'
+ * (baseline) against the table interpolation with Newton refinement, table
+ * only, and the batch form; reports the largest relative deviation
+ *
+ * usage: bench_li [count]
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "../flott_math.h"
+
+int
+main (int argc, char **argv)
+{
+  size_t count = (argc > 1) ? (size_t) atol (argv[1]) : 200000;
+  double *t_complexity = (double *) malloc (count * sizeof (double));
+  double *expected = (double *) malloc (count * sizeof (double));
+  double *actual = (double *) malloc (count * sizeof (double));
+  double seconds, baseline, deviation, largest;
+  unsigned int state = 1;
+  size_t i;
+  int variant;
+  static const char *name[] = { "table + newton", "table only",
+                                "batch, table only" };
+
+  for (i = 0; i < count; i++) /* t in [1, e^20], log-uniform */
+    {
+      state = state * 1103515245u + 12345u;
+      t_complexity[i] = exp ((double) (state >> 8) / (double) (1u << 24)
+                             * 20.0);
+    }
+
+  printf ("inverse logarithmic integral: %zu values of t in [1, e^20]\n",
+          count);
+  seconds = bench_now ();
+  for (i = 0; i < count; i++)
+    {
+      expected[i] = flott_get_t_information (t_complexity[i]);
+    }
+  seconds = bench_now () - seconds;
+  baseline = count / seconds;
+  bench_report ("iterative solver", baseline, "values/s", seconds, 0.0);
+
+  for (variant = 0; variant < 3; variant++)
+    {
+      seconds = bench_now ();
+      if (variant == 2)
+        {
+          flott_get_t_information_batch (t_complexity, actual, count, 1e-6);
+        }
+      else
+        {
+          for (i = 0; i < count; i++)
+            {
+              actual[i] = flott_get_t_information_fast (t_complexity[i],
+                                                       (variant == 0) ? 0.0
+                                                                      : 1e-6);
+            }
+        }
+      seconds = bench_now () - seconds;
+
+      for (i = 0, largest = 0.0; i < count; i++)
+        {
+          deviation = fabs (actual[i] - expected[i]) / expected[i];
+          largest = (deviation > largest) ? deviation : largest;
+        }
+      bench_report (name[variant], count / seconds, "values/s", seconds,
+                    baseline);
+      printf ("  %-34s %12.2e\n", "  largest relative deviation", largest);
+    }
+
+  free (actual);
+  free (expected);
+  free (t_complexity);
+  return 0;
+}
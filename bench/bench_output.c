@@ -0,0 +1,220 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * step output throughput: the t-augmentation steps of one transform are
+ * recorded, then replayed through 'flott_output_records' with the columns
+ * of 'flott -nkolcier' into a temporary file as pretty printed text
+ * (baseline), csv, tab separated and binary records; second, whole runs
+ * through 'flott_output' in each format against a transform without step
+ * output
+ *
+ * usage: bench_output [length]
+ */
+
+#include <sys/stat.h>
+
+#include "bench.h"
+#include "../flott_output.h"
+
+#define BENCH_RUNS 3
+
+typedef struct bench_steps bench_steps;
+
+struct bench_steps
+{
+  flott_step_record *record;
+  size_t length;
+  size_t capacity;
+};
+
+static void
+bench_capture (flott_object *op, const flott_step_record *record,
+               const size_t count, int *terminate)
+{
+  bench_steps *steps = (bench_steps *) op->user;
+
+  (void) terminate;
+  if (steps->length + count > steps->capacity)
+    {
+      steps->capacity = 2 * (steps->length + count);
+      steps->record = (flott_step_record *)
+          realloc (steps->record, steps->capacity * sizeof (flott_step_record));
+    }
+  memcpy (&steps->record[steps->length], record,
+          count * sizeof (flott_step_record));
+  steps->length += count;
+}
+
+/**
+ * step output options of 'flott -nkolcier' in 'format', writing to 'path'
+ */
+static void
+bench_set_output (flott_object *op, flott_user_output *output,
+                  flott_output_options format, char *path)
+{
+  memset (output, 0, sizeof (flott_user_output));
+  output->options = FLOTT_OUT_UNITS_BITS | FLOTT_OUT_CONCAT_INPUT
+                    | FLOTT_OUT_T_AUG_LEVEL | FLOTT_OUT_CF
+                    | FLOTT_OUT_CP_OFFSET | FLOTT_OUT_CP_LENGTH
+                    | FLOTT_OUT_T_COMPLEXITY | FLOTT_OUT_T_INFORMATION
+                    | FLOTT_OUT_AVE_T_ENTROPY | FLOTT_OUT_INST_T_ENTROPY
+                    | format;
+  output->precision = 2;
+  output->storage_type = FLOTT_DEV_FILE;
+  output->path = path;
+  op->user = output;
+  if (flott_set_output_device (op) != FLOTT_SUCCESS)
+    {
+      fprintf (stderr, "cannot open %s\n", path);
+      exit (1);
+    }
+}
+
+/**
+ * write the recorded steps of the initialized 'op' in 'format', best of
+ * three runs, file close included
+ */
+static double
+bench_replay (flott_object *op, flott_user_output *output,
+              flott_output_options format, const bench_steps *steps,
+              char *path)
+{
+  double best = 0.0, seconds;
+  size_t i, count;
+  int run, terminate;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      bench_set_output (op, output, format, path);
+      seconds = bench_now ();
+      flott_output_initialize (op);
+      flott_output_print_headers (op);
+      terminate = false;
+      for (i = 0; i < steps->length; i += count)
+        {
+          count = steps->length - i;
+          count = (count < FLOTT_OUT_RECORD_BUFSZ) ? count
+                                                   : FLOTT_OUT_RECORD_BUFSZ;
+          flott_output_records (op, &steps->record[i], count, &terminate);
+        }
+      flott_output_destroy (op);
+      seconds = bench_now () - seconds;
+      best = (run == 0 || seconds < best) ? seconds : best;
+    }
+  return best;
+}
+
+/**
+ * transform 'data' through 'flott_output' in 'format' (0: a transform
+ * without step output), best of three runs
+ */
+static double
+bench_run (flott_user_output *output, flott_output_options format,
+           char *data, size_t length, char *path)
+{
+  flott_object *op;
+  double best = 0.0, seconds;
+  int run;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      seconds = bench_now ();
+      if (format == 0)
+        {
+          flott_initialize (op);
+          flott_t_transform_policy (op, FLOTT_OBSERVE_NONE);
+        }
+      else
+        {
+          bench_set_output (op, output, format, path);
+          op->handler.init = &flott_output_initialize;
+          op->handler.record = &flott_output_records;
+          op->step_buffer.record = output->records;
+          op->step_buffer.size = FLOTT_OUT_RECORD_BUFSZ;
+          op->handler.destroy = &flott_output_destroy;
+          if (flott_output (op) != FLOTT_SUCCESS)
+            {
+              fprintf (stderr, "step output failed\n");
+              exit (1);
+            }
+        }
+      flott_destroy (op); ///< closes the output file
+      seconds = bench_now () - seconds;
+      best = (run == 0 || seconds < best) ? seconds : best;
+    }
+  return best;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const flott_output_options format[] = { FLOTT_OUT_PRETTY,
+                                                 FLOTT_OUT_CSV, FLOTT_OUT_TAB,
+                                                 FLOTT_OUT_BINARY, 0 };
+  static const char *name[] = { "pretty", "csv", "tab", "binary",
+                                "no step output" };
+  static flott_user_output output;
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (2u << 20);
+  char *data = fixture_make_input (length, 4);
+  char *path = fixture_make_file ("", 0);
+  flott_step_record records[FLOTT_OUT_RECORD_BUFSZ];
+  flott_object *op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  bench_steps steps = { NULL, 0, 0 };
+  double seconds, baseline = 0.0;
+  struct stat status;
+  char label[64];
+  int i;
+
+  op->user = &steps;
+  op->handler.record = &bench_capture;
+  op->step_buffer.record = records;
+  op->step_buffer.size = FLOTT_OUT_RECORD_BUFSZ;
+  flott_initialize (op);
+  flott_t_transform_policy (op, FLOTT_OBSERVE_RECORD);
+
+  printf ("step output: %zu bytes, %zu steps, best of %d\n", length,
+          steps.length, BENCH_RUNS);
+  for (i = 0; i < 4; i++)
+    {
+      seconds = bench_replay (op, &output, format[i], &steps, path);
+      if (i == 0) baseline = steps.length / seconds / 1e6;
+      stat (path, &status);
+      sprintf (label, "%s, %.1f MB", name[i], (double) status.st_size / 1e6);
+      bench_report (label, steps.length / seconds / 1e6, "Mrows/s", seconds,
+                    (i == 0) ? 0.0 : baseline);
+    }
+  op->user = NULL;
+  flott_destroy (op);
+
+  printf ("transform and step output\n");
+  for (i = 0; i < 5; i++)
+    {
+      seconds = bench_run (&output, format[i], data, length, path);
+      if (i == 0) baseline = length / seconds / 1e6;
+      bench_report (name[i], length / seconds / 1e6, "MB/s", seconds,
+                    (i == 0) ? 0.0 : baseline);
+    }
+
+  unlink (path);
+  free (path);
+  free (steps.record);
+  free (data);
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * observer policy cost: t-transform time of the observer-free instance
+ * (baseline) against the progress-only, statistics, boundary and callback
+ * instances, best of three runs each
+ *
+ * usage: bench_policy [length]
+ */
+
+#include "bench.h"
+
+#define BENCH_RUNS 3
+
+extern void flott_t_transform_simple (flott_object *op);
+
+static void
+bench_progress (const flott_object *op, const float fraction)
+{
+  (void) op;
+  (void) fraction;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *name[] = { "observer free", "progress only",
+                                "statistics", "boundary", "callback" };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (8u << 20);
+  char *data = fixture_make_input (length, 3);
+  flott_object *op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  double best[5], seconds, baseline_tc = 0.0;
+  int i, run;
+
+  printf ("observer policies: %zu bytes, best of %d\n", length, BENCH_RUNS);
+  for (i = 0; i < 5; i++)
+    {
+      best[i] = 0.0;
+      for (run = 0; run < BENCH_RUNS; run++)
+        {
+          flott_initialize (op);
+          seconds = bench_now ();
+          switch (i)
+            {
+              case 0 : flott_t_transform_simple (op); break;
+              case 1 :
+                op->handler.progress = &bench_progress;
+                flott_t_transform (op);
+                op->handler.progress = NULL;
+                break;
+              case 2 :
+                flott_t_transform_policy (op, FLOTT_OBSERVE_STATS);
+                break;
+              case 3 :
+                op->boundary.offset = length / 2;
+                flott_t_transform_policy (op, FLOTT_OBSERVE_BOUNDARY);
+                break;
+              default : flott_t_transform_callback (op); break;
+            }
+          seconds = bench_now () - seconds;
+          best[i] = (run == 0 || seconds < best[i]) ? seconds : best[i];
+          if (i == 0)
+            {
+              baseline_tc = op->result.t_complexity;
+            }
+          else if (op->result.t_complexity != baseline_tc)
+            {
+              fprintf (stderr, "%s: result mismatch\n", name[i]);
+              return 1;
+            }
+          flott_deinitialize (op);
+        }
+      bench_report (name[i], length / best[i] / 1e6, "MB/s", best[i],
+                    (i == 0) ? 0.0 : length / best[0] / 1e6);
+    }
+
+  flott_destroy (op);
+  free (data);
+  return 0;
+}
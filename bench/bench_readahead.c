@@ -0,0 +1,123 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * file read-ahead: level-zero initialization of one large streamed file
+ * (reader thread) and of many small concatenated files (page cache
+ * prefetch of the next inputs), each with the page cache dropped ('cold')
+ * against populated ('warm', baseline); the large file is also loaded to
+ * memory in one read for comparison
+ *
+ * usage: bench_readahead [length] [files]
+ */
+
+#include "bench.h"
+
+#define BENCH_RUNS 3
+
+/**
+ * initialize the first 'count' sources of 'path', best of three runs
+ */
+static double
+bench_initialize (flott_storage_type storage_type, char **path, size_t count,
+                  int cold)
+{
+  flott_object *op;
+  double best = 0.0, seconds;
+  size_t i;
+  int run;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      op = flott_create_instance (count);
+      memset (op->input.source, 0, count * sizeof (flott_source));
+      op->input.deallocate = true; ///< loaded sources
+      for (i = 0; i < count; i++)
+        {
+          op->input.source[i].storage_type = storage_type;
+          op->input.source[i].path = path[i];
+          op->input.source[i].length = flott_get_file_size (path[i]);
+          if (cold) bench_evict (path[i]);
+        }
+      seconds = bench_now ();
+      if (flott_initialize (op) != FLOTT_SUCCESS)
+        {
+          fprintf (stderr, "initialization failed\n");
+          exit (1);
+        }
+      seconds = bench_now () - seconds;
+      best = (run == 0 || seconds < best) ? seconds : best;
+      flott_destroy (op);
+    }
+  return best;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *name[] = { "warm", "cold" };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (64u << 20);
+  size_t files = (argc > 2) ? (size_t) atol (argv[2]) : 10000;
+  char **path = (char **) malloc (files * sizeof (char *));
+  char *data = fixture_make_input (length, 8);
+  char *large = fixture_make_file (data, length);
+  double seconds, baseline = 0.0;
+  size_t i, total = 0;
+  char label[64];
+  int cold;
+
+  for (i = 0; i < files; i++) ///< 200 to 1800 bytes each, length > 1800
+    {
+      path[i] = fixture_make_file (data + (i * 4099) % (length - 1800),
+                                   200 + (i * 7919) % 1600);
+      total += 200 + (i * 7919) % 1600;
+    }
+
+  printf ("read-ahead: %zu byte file, %zu files of %zu bytes, best of %d\n",
+          length, files, total, BENCH_RUNS);
+  for (cold = 0; cold < 2; cold++)
+    {
+      seconds = bench_initialize (FLOTT_DEV_FILE, &large, 1, cold);
+      baseline = (cold == 0) ? length / seconds / 1e6 : baseline;
+      sprintf (label, "large file, streamed, %s", name[cold]);
+      bench_report (label, length / seconds / 1e6, "MB/s", seconds,
+                    (cold == 0) ? 0.0 : baseline);
+      seconds = bench_initialize (FLOTT_DEV_FILE_TO_MEM, &large, 1, cold);
+      sprintf (label, "large file, loaded, %s", name[cold]);
+      bench_report (label, length / seconds / 1e6, "MB/s", seconds, baseline);
+    }
+  for (cold = 0; cold < 2; cold++)
+    {
+      seconds = bench_initialize (FLOTT_DEV_FILE, path, files, cold);
+      baseline = (cold == 0) ? files / seconds : baseline;
+      sprintf (label, "small files, %s", name[cold]);
+      bench_report (label, files / seconds, "files/s", seconds,
+                    (cold == 0) ? 0.0 : baseline);
+    }
+
+  for (i = 0; i < files; i++)
+    {
+      unlink (path[i]);
+      free (path[i]);
+    }
+  unlink (large);
+  free (large);
+  free (path);
+  free (data);
+  return 0;
+}
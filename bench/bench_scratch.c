@@ -0,0 +1,128 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * out-of-core t-transform: the in-memory workspace (baseline) against a
+ * workspace mapped onto a scratch file in $TMPDIR (default /tmp), for an
+ * input whose workspace fits into memory; initialization (scratch file
+ * reservation, level-zero tokens), transform and release of the workspace
+ * are timed separately
+ *
+ * usage: bench_scratch [length]
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "../flott_lang.h"
+
+#define BENCH_RUNS 3
+
+typedef struct bench_times bench_times;
+
+struct bench_times
+{
+  double initialize;
+  double transform;
+  double release;
+};
+
+static void
+bench_keep_best (double *best, double seconds, int run)
+{
+  *best = (run == 0 || seconds < *best) ? seconds : *best;
+}
+
+/**
+ * transform 'data', on a scratch workspace in 'directory' unless it is
+ * NULL, best of three runs of each phase
+ */
+static double
+bench_transform (char *data, size_t length, const char *directory,
+                 bench_times *times, flott_backing *backing)
+{
+  flott_object *op;
+  double seconds, t_complexity = 0.0;
+  int run;
+
+  for (run = 0; run < BENCH_RUNS; run++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      op->scratch.path = directory;
+      op->scratch.threshold = 0;
+      seconds = bench_now ();
+      if (flott_initialize (op) != FLOTT_SUCCESS)
+        {
+          fprintf (stderr, "initialization failed\n");
+          exit (1);
+        }
+      bench_keep_best (&times->initialize, bench_now () - seconds, run);
+      *backing = flott_get_workspace_backing (op);
+      seconds = bench_now ();
+      flott_t_transform (op);
+      bench_keep_best (&times->transform, bench_now () - seconds, run);
+      t_complexity = op->result.t_complexity;
+      seconds = bench_now ();
+      flott_destroy (op);
+      bench_keep_best (&times->release, bench_now () - seconds, run);
+    }
+  return t_complexity;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *name[] = { "in memory", "scratch file" };
+  const char *directory = getenv ("TMPDIR");
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (8u << 20);
+  char *data = fixture_make_input (length, 10);
+  double t_complexity[2];
+  bench_times times[2];
+  flott_backing backing;
+  int variant;
+
+  directory = (directory != NULL) ? directory : "/tmp";
+  printf ("out-of-core: %zu bytes, %zu byte workspace, scratch in %s, "
+          "best of %d\n", length,
+          flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE), directory,
+          BENCH_RUNS);
+  for (variant = 0; variant < 2; variant++)
+    {
+      t_complexity[variant] = bench_transform (data, length, (variant == 0)
+                                               ? NULL : directory,
+                                               &times[variant], &backing);
+      printf ("  %s (%s)\n", name[variant], flott_backing_lut_G[backing]);
+      bench_report ("  initialize", length / times[variant].initialize / 1e6,
+                    "MB/s", times[variant].initialize, (variant == 0)
+                    ? 0.0 : length / times[0].initialize / 1e6);
+      bench_report ("  t-transform", length / times[variant].transform / 1e6,
+                    "MB/s", times[variant].transform, (variant == 0)
+                    ? 0.0 : length / times[0].transform / 1e6);
+      bench_report ("  release", length / times[variant].release / 1e6,
+                    "MB/s", times[variant].release, (variant == 0)
+                    ? 0.0 : length / times[0].release / 1e6);
+    }
+  if (fabs (t_complexity[1] - t_complexity[0]) > 1e-9 * t_complexity[0])
+    {
+      fprintf (stderr, "t-complexities differ\n");
+      return 1;
+    }
+
+  free (data);
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * short string throughput: one object per string on the 32-bit engine
+ * (baseline), the same on the 16-bit engine, and 'flott_short_batch'
+ *
+ * usage: bench_short [count] [length]
+ */
+
+#include "bench.h"
+#include "../flott_short.h"
+
+extern void flott_t_transform_simple (flott_object *op);
+
+static double
+bench_per_object (const flott_short_input *input, size_t count,
+                  flott_offset_type offset_type, double *t_complexity)
+{
+  double start = bench_now ();
+  flott_object *op;
+  size_t i;
+
+  for (i = 0; i < count; i++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, input[i].bytes,
+                                input[i].length, NULL);
+      op->input.offset_type = offset_type;
+      flott_initialize (op);
+      flott_t_transform_simple (op);
+      t_complexity[i] = op->result.t_complexity;
+      flott_deinitialize (op);
+      flott_destroy (op);
+    }
+  return bench_now () - start;
+}
+
+int
+main (int argc, char **argv)
+{
+  size_t count = (argc > 1) ? (size_t) atol (argv[1]) : 200000;
+  size_t length = (argc > 2) ? (size_t) atol (argv[2]) : 32;
+  flott_short_input *input;
+  double *expected, *t_complexity, *t_information;
+  double seconds, baseline;
+  char *data;
+  size_t i;
+
+  if (length < 1 || length > FLOTT_SHORT_MAX_LENGTH) return 1;
+  data = fixture_make_input (count * length, 1);
+  input = (flott_short_input *) malloc (count * sizeof (flott_short_input));
+  expected = (double *) malloc (count * sizeof (double));
+  t_complexity = (double *) malloc (count * sizeof (double));
+  t_information = (double *) malloc (count * sizeof (double));
+  for (i = 0; i < count; i++)
+    {
+      input[i].bytes = data + i * length;
+      input[i].length = length;
+    }
+
+  printf ("short strings: %zu x %zu bytes\n", count, length);
+  seconds = bench_per_object (input, count, FLOTT_OFFSET_32BIT, expected);
+  baseline = count / seconds;
+  bench_report ("per object, 32-bit engine", baseline, "strings/s", seconds,
+                0.0);
+  seconds = bench_per_object (input, count, FLOTT_OFFSET_16BIT, t_complexity);
+  bench_report ("per object, 16-bit engine", count / seconds, "strings/s",
+                seconds, baseline);
+
+  seconds = bench_now ();
+  flott_short_batch (NULL, input, count, NULL, 0, t_complexity, NULL);
+  seconds = bench_now () - seconds;
+  bench_report ("batch", count / seconds, "strings/s", seconds, baseline);
+  seconds = bench_now ();
+  flott_short_batch (NULL, input, count, NULL, 0, t_complexity, t_information);
+  seconds = bench_now () - seconds;
+  bench_report ("batch with t-information", count / seconds, "strings/s",
+                seconds, baseline);
+
+  for (i = 0; i < count; i++)
+    {
+      if (t_complexity[i] != expected[i])
+        {
+          fprintf (stderr, "result mismatch at string %zu\n", i);
+          return 1;
+        }
+    }
+
+  free (t_information);
+  free (t_complexity);
+  free (expected);
+  free (input);
+  free (data);
+  return 0;
+}
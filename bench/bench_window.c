@@ -0,0 +1,120 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * sliding window throughput: a separate create/initialize/transform/destroy
+ * run per window (baseline) against 'flott_t_transform_window', on a memory
+ * source and on a streamed file
+ *
+ * usage: bench_window [length]
+ */
+
+#include "bench.h"
+
+extern void flott_t_transform_simple (flott_object *op);
+
+static double checksum_G;
+
+static void
+bench_window (flott_object *op, const size_t offset,
+              const flott_result *result, int *terminate)
+{
+  (void) op;
+  (void) offset;
+  (void) terminate;
+  checksum_G += result->t_complexity;
+}
+
+static double
+bench_naive (char *data, size_t length, size_t size, size_t stride,
+             size_t *count)
+{
+  double start = bench_now ();
+  flott_object *op;
+  size_t offset;
+
+  *count = 0;
+  checksum_G = 0.0;
+  for (offset = 0; offset + size <= length; offset += stride)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data + offset, size, NULL);
+      flott_initialize (op);
+      flott_t_transform_simple (op);
+      checksum_G += op->result.t_complexity;
+      flott_destroy (op);
+      (*count)++;
+    }
+  return bench_now () - start;
+}
+
+static double
+bench_api (flott_storage_type storage_type, char *data, char *path,
+           size_t length, size_t size, size_t stride)
+{
+  flott_object *op = fixture_make_object (storage_type, data, length, path);
+  double start = bench_now ();
+
+  checksum_G = 0.0;
+  op->window.size = size;
+  op->window.stride = stride;
+  op->handler.window = &bench_window;
+  flott_t_transform_window (op);
+  start = bench_now () - start;
+  flott_destroy (op);
+  return start;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const size_t size[] = { 1024, 4096, 65536 };
+  static const size_t stride[] = { 1024, 2048, 32768 };
+  size_t length = (argc > 1) ? (size_t) atol (argv[1]) : (8u << 20);
+  char *data = fixture_make_input (length, 9);
+  char *path = fixture_make_file (data, length);
+  double seconds, baseline, expected;
+  size_t i, count;
+  char name[64];
+
+  printf ("sliding windows: %zu bytes\n", length);
+  for (i = 0; i < sizeof (size) / sizeof (size[0]); i++)
+    {
+      seconds = bench_naive (data, length, size[i], stride[i], &count);
+      baseline = count / seconds;
+      expected = checksum_G;
+      sprintf (name, "%zu/%zu, separate runs", size[i], stride[i]);
+      bench_report (name, baseline, "windows/s", seconds, 0.0);
+
+      seconds = bench_api (FLOTT_DEV_MEM, data, NULL, length, size[i],
+                           stride[i]);
+      sprintf (name, "%zu/%zu, window mode, memory", size[i], stride[i]);
+      bench_report (name, count / seconds, "windows/s", seconds, baseline);
+      if (checksum_G != expected) return 1;
+
+      seconds = bench_api (FLOTT_DEV_FILE, NULL, path, length, size[i],
+                           stride[i]);
+      sprintf (name, "%zu/%zu, window mode, file", size[i], stride[i]);
+      bench_report (name, count / seconds, "windows/s", seconds, baseline);
+      if (checksum_G != expected) return 1;
+    }
+
+  unlink (path);
+  free (path);
+  free (data);
+  return 0;
+}
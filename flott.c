@@ -23,30 +23,76 @@
 #include "flott_math.h"
 #include "flott_util.h"
 #include "flott_term.h"
+#include "flott_thread.h"
 
 /**
  * local function pointer type definitions
  */
-typedef size_t (flott_init_symbols) (char *, size_t, flott_token *,
-                                     size_t, flott_match_list *, size_t);
+typedef void (flott_t_transform_fn) (flott_object *);
+
+/**
+ * local function prototypes (used by the engine instances)
+ */
+static size_t flott_release_scratch (flott_object *op, size_t token_offset,
+                                     size_t token_size);
+static FILE *flott_prefetch_take (flott_object *op, const flott_source *source);
+static void flott_input_close (flott_object *op);
+
+/**
+ * t-transform engine instances over 16-bit, 32-bit (default) and 64-bit
+ * token offsets
+ */
+#define FLOTT_E_UINT flott_uint16
+#define FLOTT_E_TOKEN flott_token16
+#define FLOTT_E_ML flott_match_list16
+#define FLOTT_E_SUFFIX _16
+#include "flott_engine.def"
+
+#define FLOTT_E_UINT flott_uint
+#define FLOTT_E_TOKEN flott_token
+#define FLOTT_E_ML flott_match_list
+#define FLOTT_E_SUFFIX _32
+#include "flott_engine.def"
+
+#define FLOTT_E_UINT flott_uint64
+#define FLOTT_E_TOKEN flott_token64
+#define FLOTT_E_ML flott_match_list64
+#define FLOTT_E_SUFFIX _64
+#include "flott_engine.def"
 
 /**
  * implementation
  */
 flott_object *
 flott_create_instance (size_t input_source_count)
+{
+  return flott_create_instance_with (input_source_count, NULL);
+}
+
+/**
+ * create an object whose heap memory (object, source list, sequence list,
+ * buffers, loaded files and, unless one is lent, the token workspace) comes
+ * from 'allocator'; the allocator must outlive the object
+ */
+flott_object *
+flott_create_instance_with (size_t input_source_count,
+                            const flott_allocator *allocator)
 {
   flott_source *source = NULL;
-  flott_object *op = (flott_object *) calloc (1, sizeof (flott_object));
+  flott_object *op = (flott_object *) flott_allocate (allocator,
+                                                      sizeof (flott_object));
 
   if (op != NULL)
     {
+      memset (op, 0, sizeof (flott_object));
       op->input.symbol_type = FLOTT_SYMBOL_BYTE;
+      op->allocator = allocator;
 
       if (input_source_count > 0)
         {
-          source = (flott_source *) malloc (sizeof (flott_source)
-                                            * input_source_count);
+          source = (flott_source *) flott_allocate (allocator,
+                                                    sizeof (flott_source)
+                                                    * input_source_count);
         }
       else
         {
@@ -56,7 +102,7 @@ flott_create_instance (size_t input_source_count)
       if (input_source_count > 0 && source == NULL)
         {
           /* could not allocate source array, cleaning up */
-          free (op);
+          flott_deallocate (allocator, op);
           op = NULL;
         }
       else
@@ -68,336 +114,306 @@ flott_create_instance (size_t input_source_count)
   return op;
 }
 
-size_t
-flott_initialize_bits (char *data,
-                       size_t data_length,
-                       flott_token *tl_bp,
-                       size_t token_offset,
-                       flott_match_list *ml_header_bp,
-                       size_t ml_header_offset)
+int
+flott_initialize_input (flott_object *op)
 {
-  /* bit mask lut used for fast bit isolation */
-  static const size_t bit_mask[8] =
-      { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
-
-  int i;
-  size_t data_byte;
-  size_t data_ordinal;
-  flott_match_list *ml_header;
-  flott_token *ml_token;
-  flott_token *tl_token = tl_bp + token_offset;
-
-  while (data_length-- > 0)
-    {
-      data_byte = *data++;
-      i = 8;
-      while (--i >= 0)
-        {
-          /* printf("%x,%d  \n", bit_mask[i],  ((data_byte & bit_mask[i]) >> i) ); */
-          data_ordinal = (data_byte & bit_mask[i]) >> i;
+  int ret_val;
 
-          /* printf("%d, %d\n", (int) token_offset, (int) data_ordinal);
-          fflush(stdout); */
+  /* level-zero tokens are written front to back */
+  if (op->_private.backing == FLOTT_BACKING_SCRATCH)
+    {
+      flott_advise_file ((char *) op->_private.base_pointer,
+                         op->_private.allocation_size,
+                         FLOTT_ADVISE_SEQUENTIAL);
+    }
 
-          ml_header = flott_get_ptr_M (ml_header_bp, data_ordinal);
-          if (ml_header->length == 0)
-            {
-              ml_header->first_match =  (flott_uint) token_offset;
-            }
-          else
-            {
-              ml_token = flott_get_ptr_M (tl_bp, ml_header->last_match);
-              ml_token->next_match = (flott_uint) token_offset;
-            }
+  /* populate token list using the engine matching the token offset width */
+  switch (op->_private.offset_type)
+    {
+      case FLOTT_OFFSET_16BIT : ret_val = flott_initialize_input_16 (op); break;
+      case FLOTT_OFFSET_64BIT : ret_val = flott_initialize_input_64 (op); break;
+      default : ret_val = flott_initialize_input_32 (op); break;
+    }
 
-          tl_token->previous_match = ml_header->last_match;
-          tl_token->next_match = FLOTT_NIL;
+  return ret_val;
+}
 
-          ml_header->last_match = (flott_uint) token_offset;
-          (ml_header->length)++;
+static size_t
+flott_get_token_size (flott_offset_type offset_type)
+{
+  switch (offset_type)
+    {
+      case FLOTT_OFFSET_16BIT : return sizeof (flott_token16);
+      case FLOTT_OFFSET_64BIT : return sizeof (flott_token64);
+      default : return sizeof (flott_token);
+    }
+}
 
-          tl_token->uid = (flott_uint) (ml_header_offset + data_ordinal);
-          tl_token->previous_token = (flott_uint) (token_offset - 1);
-          tl_token->next_token = (flott_uint) ++token_offset;
+flott_offset_type
+flott_get_offset_type (size_t tl_length, size_t *token_size)
+{
+  flott_offset_type offset_type;
 
-          tl_token++;
-        }
+  /* use the narrowest token offsets able to address the token list (the
+   * smaller the tokens, the smaller the cache footprint); reserve space for
+   * level zero match list headers, stop symbol, and head/tail nodes */
+  if (tl_length <= FLOTT_UINT16_MAX - FLOTT_SYMBOL_BYTE - 1 - 2)
+    {
+      offset_type = FLOTT_OFFSET_16BIT;
+    }
+  else if (tl_length <= FLOTT_UINT_MAX - FLOTT_SYMBOL_BYTE - 1 - 2)
+    {
+      offset_type = FLOTT_OFFSET_32BIT;
+    }
+  else
+    {
+      offset_type = FLOTT_OFFSET_64BIT;
     }
-  return token_offset;
+  *token_size = flott_get_token_size (offset_type);
+
+  return offset_type;
 }
 
 size_t
-flott_initialize_bytes (char *data,
-                        size_t data_length,
-                        flott_token *tl_bp,
-                        size_t token_offset,
-                        flott_match_list *ml_header_bp,
-                        size_t ml_header_offset)
+flott_get_workspace_size (size_t input_length, flott_symbol_type symbol_type)
 {
-  size_t data_ordinal;
-  flott_match_list *ml_header;
-  flott_token *ml_token;
-  flott_token *tl_token = tl_bp + token_offset;
+  size_t token_size;
+
+  if (symbol_type == FLOTT_SYMBOL_BIT)
+    {
+      input_length <<= 3; ///< multiply by 8
+    }
+  flott_get_offset_type (input_length, &token_size);
+
+  return (input_length + FLOTT_SYMBOL_BYTE + 3) * token_size;
+}
 
-  while (data_length-- > 0)
+/**
+ * free the workspace of 'op', unless it is owned by the caller
+ */
+static void
+flott_release_workspace (flott_object *op)
+{
+  if (op->_private.base_pointer != NULL && op->_private.borrowed == false)
     {
-      data_ordinal = (unsigned char) *data++;
-      ml_header = flott_get_ptr_M (ml_header_bp, data_ordinal);
-      if (ml_header->length == 0)
+      if (op->_private.backing == FLOTT_BACKING_ALLOCATOR)
         {
-          ml_header->first_match =  (flott_uint) token_offset;
+          flott_deallocate (op->allocator, op->_private.base_pointer);
         }
       else
         {
-          ml_token = flott_get_ptr_M (tl_bp, ml_header->last_match);
-          ml_token->next_match = (flott_uint) token_offset;
+          flott_free_workspace (op->_private.base_pointer,
+                                op->_private.allocation_size,
+                                op->_private.backing);
         }
-
-      tl_token->previous_match = ml_header->last_match;
-      tl_token->next_match = FLOTT_NIL;
-
-      ml_header->last_match = (flott_uint) token_offset;
-      (ml_header->length)++;
-
-      tl_token->uid = (flott_uint) (ml_header_offset + data_ordinal);
-      tl_token->previous_token = (flott_uint) (token_offset - 1);
-      tl_token->next_token = (flott_uint) ++token_offset;
-
-      tl_token++;
     }
-  return token_offset;
+  op->_private.base_pointer = NULL;
+  op->_private.allocation_size = 0;
+  op->_private.borrowed = false;
+  op->_private.backing = FLOTT_BACKING_NONE;
 }
 
-size_t
-flott_initialize_stop_symbol (char *data,
-                        flott_token *tl_bp,
-                        size_t token_offset,
-                        flott_match_list *ml_header_bp,
-                        size_t ml_header_offset)
+/**
+ * allocate a workspace of 'size' bytes for 'op': out-of-core on a scratch
+ * file if requested, else from the object's allocator if set, else see
+ * 'flott_alloc_workspace'
+ */
+static void *
+flott_acquire_workspace (flott_object *op, size_t size)
 {
-  flott_match_list *ml_header;
-  flott_token *ml_token;
-  flott_token *tl_token = tl_bp + token_offset;
-
-  ml_header = flott_get_ptr_M (ml_header_bp, FLOTT_STOP_SYMBOL);
-  if (ml_header->length == 0)
+  if (op->scratch.path != NULL && size >= op->scratch.threshold)
     {
-      ml_header->first_match =  (flott_uint) token_offset;
+      op->_private.base_pointer = flott_map_scratch (op->scratch.path, size,
+                                                     op->allocator);
+      op->_private.backing = FLOTT_BACKING_SCRATCH;
+    }
+  else if (op->allocator != NULL)
+    {
+      op->_private.base_pointer = flott_allocate (op->allocator, size);
+      op->_private.backing = FLOTT_BACKING_ALLOCATOR;
     }
   else
     {
-      ml_token = flott_get_ptr_M (tl_bp, ml_header->last_match);
-      ml_token->next_match = (flott_uint) token_offset;
+      op->_private.base_pointer =
+          flott_alloc_workspace (size, &(op->_private.backing));
     }
+  op->_private.allocation_size = (op->_private.base_pointer != NULL)
+                                 ? size : 0;
+  op->_private.borrowed = false;
 
-  tl_token->previous_match = ml_header->last_match;
-  tl_token->next_match = FLOTT_NIL;
-
-  ml_header->last_match = (flott_uint) token_offset;
-  (ml_header->length)++;
-
-  tl_token->uid = (flott_uint) (ml_header_offset + FLOTT_STOP_SYMBOL);
-  tl_token->previous_token = (flott_uint) (token_offset - 1);
-  tl_token->next_token = (flott_uint) ++token_offset;
-  return token_offset;
+  if (op->_private.base_pointer != NULL)
+    {
+      flott_set_status (op, FLOTT_MSG_WORKSPACE, FLOTT_VL_INFO, size,
+                        flott_backing_lut_G[op->_private.backing]);
+    }
+  return op->_private.base_pointer;
 }
 
-size_t
-flott_initialize_bytes_dna (char *data,
-                            size_t data_length,
-                            flott_token *tl_bp,
-                            size_t token_offset,
-                            flott_match_list *ml_header_bp,
-                            size_t ml_header_offset)
+flott_backing
+flott_get_workspace_backing (const flott_object *op)
 {
-  /* TODO: stub, implement use byte-wise for now */
-  return token_offset;
+  return op->_private.backing;
 }
 
+/**
+ * make sure 'workspace' can hold the t-transform data structures of inputs
+ * of up to 'input_length' symbols; grows (and never shrinks) the workspace
+ */
 int
-flott_initialize_input (flott_object *op)
+flott_workspace_reserve (flott_workspace *workspace, size_t input_length,
+                         flott_symbol_type symbol_type)
 {
-  int ret_val = FLOTT_SUCCESS;
+  size_t size = flott_get_workspace_size (input_length, symbol_type);
 
-  void *bp = op->_private.base_pointer;
-  flott_input input = op->input;
-  flott_uint tl_length = op->_private.token_list.length;
+  if (workspace->data != NULL && workspace->size >= size)
+    {
+      return FLOTT_SUCCESS;
+    }
 
-  size_t token_offset = 1;
-  flott_token *tl_bp = (flott_token *) bp;
+  flott_workspace_release (workspace);
+  if (workspace->allocator != NULL)
+    {
+      workspace->data = flott_allocate (workspace->allocator, size);
+      workspace->backing = FLOTT_BACKING_ALLOCATOR;
+    }
+  else
+    {
+      workspace->data = flott_alloc_workspace (size, &(workspace->backing));
+    }
+  workspace->size = (workspace->data != NULL) ? size : 0;
 
-  size_t ml_header_offset = tl_length + 2;
-  flott_match_list *ml_header_bp = ((flott_match_list *) bp) + ml_header_offset;
-  size_t i, index, data_length;
-  flott_match_list *ml_header = ml_header_bp;
+  return (workspace->data != NULL) ? FLOTT_SUCCESS : FLOTT_ERR_MALLOC_FLOTT;
+}
 
-  char *data = NULL;
-  char *filename;
-  char data_page[16 * FLOTT_PAGE_SIZE]; ///< read 16 pages at a time
-  FILE *fp;
-  size_t read_bytes, total_read_bytes;
+void
+flott_workspace_release (flott_workspace *workspace)
+{
+  if (workspace->backing == FLOTT_BACKING_ALLOCATOR)
+    {
+      flott_deallocate (workspace->allocator, workspace->data);
+    }
+  else
+    {
+      flott_free_workspace (workspace->data, workspace->size,
+                            workspace->backing);
+    }
+  workspace->data = NULL;
+  workspace->size = 0;
+  workspace->backing = FLOTT_BACKING_NONE;
+}
 
-  flott_token *tl_token;
-  flott_init_symbols *initialize_symbols;
+/**
+ * lend 'workspace' to 'op' (until the next call or 'flott_destroy'); objects
+ * may share a workspace as long as they don't use it at the same time
+ */
+int
+flott_use_workspace (flott_object *op, const flott_workspace *workspace)
+{
+  return flott_set_workspace (op, workspace->data, workspace->size);
+}
 
-  int offset_shift = 0;
+int
+flott_set_workspace (flott_object *op, void *workspace, size_t size)
+{
+  int ret_val = FLOTT_SUCCESS;
 
-  /* set function pointer to 1-bit/8-bit population routine */
-  if (input.symbol_type == FLOTT_SYMBOL_BIT)
+  if (op != NULL)
     {
-      offset_shift = 3; ///< multiply offsets by 8
-      initialize_symbols = &flott_initialize_bits;
+      /* release memory allocated by earlier calls to 'flott_initialize' */
+      flott_release_workspace (op);
+
+      op->_private.base_pointer = workspace;
+      op->_private.allocation_size = (workspace != NULL) ? size : 0;
+      op->_private.borrowed = (workspace != NULL);
+      op->_private.backing = (workspace != NULL) ? FLOTT_BACKING_BORROWED
+                                                 : FLOTT_BACKING_NONE;
     }
   else
     {
-      initialize_symbols = &flott_initialize_bytes;
+      ret_val = flott_set_status (op, FLOTT_ERR_INVALID_OBJ,
+                                  FLOTT_VL_FATAL, " (flott object)");
     }
 
-  /* initialize level zero match list headers
-   * (note: '<=' is no mistake; it's initializing the 'stop symbol' match list.) */
-  for(i = 0; i <= FLOTT_SYMBOL_BYTE; i++)
+  return ret_val;
+}
+
+/**
+ * make sure the workspace of 'op' holds at least 'size' bytes, so that it can
+ * be split among several t-transforms; the contents are not preserved.
+ * Returns the workspace, or NULL if a borrowed workspace is too small or
+ * the allocation failed.
+ */
+void *
+flott_reserve_workspace (flott_object *op, size_t size)
+{
+  if (op->_private.base_pointer != NULL && op->_private.allocation_size < size)
     {
-      memset (ml_header++, 0, sizeof (flott_match_list));
+      if (op->_private.borrowed == true)
+        {
+          return NULL;
+        }
+      flott_release_workspace (op);
     }
 
-  for(i = 0; i < op->input.sequence.length; i++)
+  if (op->_private.base_pointer == NULL)
     {
-      index = op->input.sequence.member[i];
-      data_length = input.source[index].length;
-      input.source[index].start_offset = (token_offset - 1) << offset_shift;
+      flott_acquire_workspace (op, size);
+    }
 
-      switch (input.source[index].storage_type)
-        {
-          case FLOTT_DEV_STOP_SYMBOL :
-            token_offset = flott_initialize_stop_symbol (data,
-                                                         tl_bp,
-                                                         token_offset,
-                                                         ml_header_bp,
-                                                         ml_header_offset);
-            break;
-          case FLOTT_DEV_MEM :
-          case FLOTT_DEV_DEALLOC_MEM :
-            {
-              /* populate flott data structures from memory pointer */
-              data = input.source[index].data.bytes;
-              if (data != NULL)
-                {
-                  token_offset = initialize_symbols (data,
-                                                     data_length,
-                                                     tl_bp,
-                                                     token_offset,
-                                                     ml_header_bp,
-                                                     ml_header_offset);
-                }
-              else
-                {
-                  ret_val = flott_set_status (op, FLOTT_ERR_NULL_POINTER,
-                                              FLOTT_VL_FATAL);
-                }
-            }
-            break;
-          case FLOTT_DEV_FILE_TO_MEM :
-            {
-              /* load entire file to memory and populate flott data structures */
-              filename = input.source[index].path;
-              if (flott_load_file_to_memory(filename, &data) == data_length)
-                {
-                  input.source[index].data.bytes = data;
-                  token_offset = initialize_symbols (data,
-                                                     data_length,
-                                                     tl_bp,
-                                                     token_offset,
-                                                     ml_header_bp,
-                                                     ml_header_offset);
-                }
-              else
-                {
-                  input.source[index].data.bytes = NULL;
-                  ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
-                                              FLOTT_VL_FATAL, filename);
-                }
+  return op->_private.base_pointer;
+}
 
-            }
-            break;
-          case FLOTT_DEV_FILE :
-            {
-              /* TODO: move this in its own function */
-              data = &data_page[0];
-              input.source[index].data.bytes = NULL;
-              filename = input.source[index].path;
-              read_bytes = 0;
-              total_read_bytes = 0;
-              fp = fopen (filename, "rb");
-              if (fp != NULL)
-                {
-                  while (true)
-                    {
-                      read_bytes = fread (data, 1, (16 * FLOTT_PAGE_SIZE), fp);
-                      total_read_bytes += read_bytes;
-                      token_offset = initialize_symbols (data,
-                                                         read_bytes,
-                                                         tl_bp,
-                                                         token_offset,
-                                                         ml_header_bp,
-                                                         ml_header_offset);
-                      /* check for end of file */
-                      if (read_bytes != (16 * FLOTT_PAGE_SIZE))
-                        {
-                          fclose (fp);
-                          if (total_read_bytes == data_length)
-                            {
-                              break;
-                            }
-                          else
-                            {
-                              ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
-                                                          FLOTT_VL_FATAL, filename);
-                            }
-                        }
-                    }
-                }
-              else
-                {
-                  ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
-                                              FLOTT_VL_FATAL, filename);
-                }
-            }
-            break;
+/**
+ * read all 'FLOTT_DEV_STREAM' sources of 'op' to the end of their stream,
+ * either from 'data.handle' (left open) or from 'path' (opened and closed
+ * here). Stream lengths are unknown up front, so each stream is drained into
+ * a growing buffer and the source turns into a 'FLOTT_DEV_DEALLOC_MEM'
+ * source owning the bytes. Called by 'flott_initialize' and by all entry
+ * points that need source lengths ahead of it; later calls are a no-op.
+ */
+int
+flott_load_streams (flott_object *op)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_source *source;
+  FILE *handle;
+  char *data;
+  size_t i, length;
 
-          /* we should never get here */
-          default:
-            ret_val = flott_set_status (op, FLOTT_ERROR, FLOTT_VL_FATAL); break;
+  for (i = 0; i < op->input.count && ret_val == FLOTT_SUCCESS; i++)
+    {
+      source = &(op->input.source[i]);
+      if (source->storage_type != FLOTT_DEV_STREAM)
+        {
+          continue;
         }
-      input.source[index].end_offset = (token_offset - 1) << offset_shift;
-    }
-
-  /* set seek position for 'flott_input_write' */
-  op->_private.input_sequence_member = i - 1;
 
+      handle = source->data.handle;
+      if (handle == NULL && source->path != NULL)
+        {
+          handle = fopen (source->path, "rb");
+        }
 
-  /* remove last symbol from input if no appended terminal character is used */
-  if (op->input.append_termchar == false && op->_private.token_list.length > 0)
-    {
-      tl_token = ((flott_token*) bp) + token_offset - 1;
-      ml_header = ((flott_match_list*) bp) + tl_token->uid;
-      (ml_header->length)--;
-      ml_header->last_match = tl_token->previous_match;
-      op->_private.token_list.second_last_token = (flott_uint) token_offset - 2;
-      (op->_private.token_list.length)--;
-    }
-  else
-    {
-      op->_private.token_list.second_last_token = (flott_uint) token_offset - 1;
-    }
+      length = (handle != NULL) ? flott_load_stream_to_memory (handle, &data,
+                                                               op->allocator)
+                                : (size_t) -1;
+      if (handle != NULL && handle != source->data.handle)
+        {
+          fclose (handle);
+        }
 
-  /* update alphabet size with the actual number of unique symbols in input */
-  if(ret_val == FLOTT_SUCCESS)
-    {
-      ml_header = ml_header_bp;
-      for(i = 0; i < input.symbol_type; i++)
+      if (length != (size_t) -1)
+        {
+          source->storage_type = FLOTT_DEV_DEALLOC_MEM;
+          source->data.bytes = data;
+          source->length = length;
+        }
+      else
         {
-          if (ml_header->length == 0) (op->alphabet_size)--;
-          ml_header++;
+          ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                      FLOTT_VL_FATAL, (source->path != NULL)
+                                                      ? source->path
+                                                      : "stream");
         }
     }
 
@@ -408,17 +424,25 @@ int
 flott_initialize (flott_object *op)
 {
   int ret_val = FLOTT_SUCCESS;
-  flott_uint tl_length;         ///< length of token list
-  flott_token *tl_token;        ///< pointer to individual token in token list
-  flott_uint max_input_length;  ///< maximum number of bytes allowed over parsing alphabet
-  flott_uint allocation_length; ///< actual token list memory units allocated
+  size_t tl_length;             ///< length of token list
+  size_t max_input_length;      ///< maximum number of bytes allowed over parsing alphabet
+  size_t allocation_length;     ///< actual token list memory units allocated
+  size_t token_size;            ///< size of a token in bytes
+  flott_offset_type offset_type;
   size_t input_length, i, index;
+  size_t extra_headers;         ///< match list headers of additional stop symbols
   void *bp; ///< base pointer to data structure memory
 
   if (op != NULL && op->input.source != NULL)
     {
       bp = op->_private.base_pointer;
 
+      /* handles of an earlier run would be lost to the new one */
+      flott_input_close (op);
+
+      /* stream lengths are only known once they are read */
+      ret_val = flott_load_streams (op);
+
       /* handy scaling factor if t-information/t-entropy are measured in nats */
        op->_private.ln2 = log (2.0);
 
@@ -443,9 +467,15 @@ flott_initialize (flott_object *op)
         }
       else /* use all sources, concatenated left-to-right */
         {
-          op->input.sequence.deallocate = true; ///< auto deallocation
-          op->input.sequence.member =
-              (size_t *) malloc (op->input.count * sizeof (size_t));
+          /* a list of an earlier call holds 'input.count' entries as well */
+          if (op->input.sequence.deallocate == false
+              || op->input.sequence.member == NULL)
+            {
+              op->input.sequence.deallocate = true; ///< auto deallocation
+              op->input.sequence.member =
+                  (size_t *) flott_allocate (op->allocator,
+                                             op->input.count * sizeof (size_t));
+            }
           if (op->input.sequence.member != NULL)
             {
               op->input.sequence.length = op->input.count;
@@ -463,10 +493,22 @@ flott_initialize (flott_object *op)
 
         }
 
+      /* every stop symbol beyond the first needs a match list header */
+      op->_private.stop_symbols = 0;
+      for (i = 0; i < op->input.sequence.length && ret_val == FLOTT_SUCCESS; i++)
+        {
+          index = op->input.sequence.member[i];
+          op->_private.stop_symbols += (op->input.source[index].storage_type
+                                        == FLOTT_DEV_STOP_SYMBOL);
+        }
+      extra_headers = (op->_private.stop_symbols > 1)
+                      ? op->_private.stop_symbols - 1 : 0;
+
       max_input_length = FLOTT_UINT_MAX
                          - FLOTT_SYMBOL_BYTE
                          - 1  ///< stop symbol space
-                         - 2; ///< space for head/tail node of token list
+                         - 2  ///< space for head/tail node of token list
+                         - extra_headers;
 
       /* check if we are supposed to use a binary source alphabet */
       if (op->input.symbol_type == FLOTT_SYMBOL_BIT)
@@ -476,6 +518,20 @@ flott_initialize (flott_object *op)
 
       op->alphabet_size = op->input.symbol_type;
 
+      /* select the engine's token offset width */
+      offset_type = flott_get_offset_type (input_length + extra_headers,
+                                           &token_size);
+      if (op->input.offset_type > offset_type)
+        {
+          offset_type = op->input.offset_type;
+          token_size = flott_get_token_size (offset_type);
+        }
+      if (offset_type == FLOTT_OFFSET_64BIT)
+        {
+          max_input_length = (SIZE_MAX / token_size)
+                             - FLOTT_SYMBOL_BYTE - 1 - 2 - extra_headers;
+        }
+
       /* make sure we don't exceed maximum offset/file size limit */
       if (input_length > max_input_length)
         {
@@ -483,42 +539,33 @@ flott_initialize (flott_object *op)
           ret_val = flott_set_status (op, FLOTT_ERR_MAX_INPUT_SIZE,
                                       FLOTT_VL_FATAL);
         }
-      else
+      else if (ret_val == FLOTT_SUCCESS)
         {
-          tl_length = (flott_uint) input_length;
+          tl_length = input_length;
 
           /* allocate memory for t-decomposition data structures */
-          allocation_length = tl_length + FLOTT_SYMBOL_BYTE + 3;
-
-          if (bp != NULL && (op->_private.allocation_length < allocation_length))
+          allocation_length = tl_length + FLOTT_SYMBOL_BYTE + 3
+                              + extra_headers;
+
+          /* a scratch file is mapped afresh for every input, since released
+           * pages also give up their disk space reservation */
+          if (bp != NULL
+              && (op->_private.allocation_size < allocation_length * token_size
+                  || op->_private.backing == FLOTT_BACKING_SCRATCH))
             {
-              free (bp);
+              /* never frees workspace memory owned by the caller */
+              flott_release_workspace (op);
               bp = NULL;
             }
 
           if (bp == NULL)
             {
-              op->_private.allocation_length = 0;
-              bp = malloc (allocation_length * sizeof (flott_token));
-              op->_private.base_pointer = bp;
+              bp = flott_acquire_workspace (op, allocation_length * token_size);
             }
 
           if (bp != NULL)
             {
-              if (op->_private.allocation_length == 0)
-                {
-                  op->_private.allocation_length = allocation_length;
-                }
-
-              /* initialize token list head and tail nodes */
-              tl_token = (flott_token *) bp;
-              memset (tl_token, 0, sizeof (flott_token));
-              tl_token->next_token = 1;
-
-              tl_token = ((flott_token *) bp) + tl_length + 1;
-              memset (tl_token, 0, sizeof (flott_token));
-              tl_token->previous_token = tl_length;
-
+              op->_private.offset_type = offset_type;
               op->_private.token_list.first_token = 1;
               op->_private.token_list.length = tl_length;
               op->input.length = tl_length;
@@ -533,6 +580,12 @@ flott_initialize (flott_object *op)
                     }
                 }
             }
+          else if (op->scratch.path != NULL
+                   && allocation_length * token_size >= op->scratch.threshold)
+            {
+              ret_val = flott_set_status (op, FLOTT_ERR_SCRATCH,
+                                          FLOTT_VL_FATAL, op->scratch.path);
+            }
           else
             {
               ret_val = flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT,
@@ -549,37 +602,195 @@ flott_initialize (flott_object *op)
   return ret_val;
 }
 
+/**
+ * find the input sequence member holding input offset 'offset' (binary
+ * search, member start offsets ascend in sequence order)
+ */
+static size_t
+flott_input_find_member (const flott_object *op, size_t offset)
+{
+  const size_t *member = op->input.sequence.member;
+  size_t low = 0;
+  size_t high = op->_private.input_sequence_member;
+  size_t middle;
+
+  while (low < high)
+    {
+      middle = low + ((high - low + 1) >> 1);
+      if (op->input.source[member[middle]].start_offset <= offset)
+        {
+          low = middle;
+        }
+      else
+        {
+          high = middle - 1;
+        }
+    }
+
+  return low;
+}
+
+/**
+ * get an open file handle for file input source 'source'; at most
+ * FLOTT_INPUT_HANDLES files are kept open, closing the least recently used
+ */
+static FILE *
+flott_input_open (flott_object *op, flott_source *source)
+{
+  flott_source **open_source = op->_private.open_source;
+  flott_source *evict;
+  size_t i;
+
+  /* find source in the open list (or the least recently used slot) */
+  for (i = 0; i < FLOTT_INPUT_HANDLES - 1; i++)
+    {
+      if (open_source[i] == source || open_source[i] == NULL) break;
+    }
+
+  evict = open_source[i];
+  if (evict != source && evict != NULL && evict->data.handle != NULL)
+    {
+      fclose (evict->data.handle);
+      evict->data.handle = NULL;
+    }
+
+  /* move source to the front of the list */
+  memmove (&open_source[1], &open_source[0], i * sizeof (flott_source *));
+  open_source[0] = source;
+
+  if (source->data.handle == NULL)
+    {
+      source->data.handle = fopen (source->path, "rb");
+    }
+  return source->data.handle;
+}
+
+/**
+ * close the file handles kept open by 'flott_input_open'
+ */
+static void
+flott_input_close (flott_object *op)
+{
+  flott_source **open_source = op->_private.open_source;
+  size_t i;
+
+  for (i = 0; i < FLOTT_INPUT_HANDLES; i++)
+    {
+      if (open_source[i] != NULL && open_source[i]->data.handle != NULL)
+        {
+          fclose (open_source[i]->data.handle);
+          open_source[i]->data.handle = NULL;
+        }
+    }
+  memset (open_source, 0, FLOTT_INPUT_HANDLES * sizeof (flott_source *));
+}
+
+/**
+ * take the handle 'flott_prefetch_input' opened for file source 'source',
+ * NULL if there is none
+ */
+static FILE *
+flott_prefetch_take (flott_object *op, const flott_source *source)
+{
+  size_t index = (size_t) (source - op->input.source);
+  size_t slot = index % FLOTT_INPUT_HANDLES;
+  FILE *handle = op->_private.prefetch_handle[slot];
+
+  if (handle == NULL || op->_private.prefetch_index[slot] != index)
+    {
+      return NULL;
+    }
+  op->_private.prefetch_handle[slot] = NULL;
+  return handle;
+}
+
+/**
+ * close the handles opened ahead and not taken
+ */
+static void
+flott_prefetch_release (flott_object *op)
+{
+  size_t slot;
+
+  for (slot = 0; slot < FLOTT_INPUT_HANDLES; slot++)
+    {
+      if (op->_private.prefetch_handle[slot] != NULL)
+        {
+          fclose (op->_private.prefetch_handle[slot]);
+          op->_private.prefetch_handle[slot] = NULL;
+        }
+    }
+}
+
+/**
+ * ask the OS to read the file sources following source 'index' into the
+ * page cache, up to FLOTT_READ_AHEAD_SIZE bytes or FLOTT_INPUT_HANDLES files
+ * ahead; small files are not double buffered, this lets the reads of the
+ * next inputs overlap the current one. Every source is prefetched once per
+ * pass over the sources; streamed sources are opened here and their handle
+ * is taken over by the initialization, so a warm page cache costs no more
+ * than the advice.
+ */
+void
+flott_prefetch_input (flott_object *op, size_t index)
+{
+  flott_source *source = op->input.source;
+  size_t cursor = op->_private.prefetch_source;
+  size_t ahead = 0, i, slot;
+
+  if (cursor <= index || cursor > index + FLOTT_INPUT_HANDLES + 1)
+    {
+      cursor = index + 1; ///< first call, or a new pass
+    }
+  for (i = index + 1; i < cursor; i++)
+    {
+      ahead += source[i].length;
+    }
+
+  while (cursor < op->input.count && cursor <= index + FLOTT_INPUT_HANDLES
+         && ahead < FLOTT_READ_AHEAD_SIZE)
+    {
+      slot = cursor % FLOTT_INPUT_HANDLES;
+      if (source[cursor].storage_type == FLOTT_DEV_FILE
+          && source[cursor].path != NULL)
+        {
+          if (op->_private.prefetch_handle[slot] != NULL) ///< left untaken
+            {
+              fclose (op->_private.prefetch_handle[slot]);
+            }
+          op->_private.prefetch_handle[slot] = fopen (source[cursor].path,
+                                                      "rb");
+          op->_private.prefetch_index[slot] = cursor;
+          flott_advise_handle (op->_private.prefetch_handle[slot],
+                               FLOTT_ADVISE_WILLNEED);
+        }
+      else if ((source[cursor].storage_type
+                & (FLOTT_DEV_FILE_TO_MEM | FLOTT_DEV_MMAP))
+               && source[cursor].path != NULL)
+        {
+          flott_prefetch_file (source[cursor].path);
+        }
+      ahead += source[cursor++].length;
+    }
+  op->_private.prefetch_source = cursor;
+}
+
 /*TODO: needs to return an error no. */
 void
 flott_input_write (flott_object *op, size_t start_offset,
                    size_t count, FILE *output_handle)
 {
   flott_private *_private = &(op->_private);
-  size_t *seq_member = &(_private->input_sequence_member);
   FILE *source_handle;
   flott_source *input_source = NULL;
 
-  size_t data_offset, data_length, index, tmp_seq_member, seq_length;
+  size_t data_offset, data_length, index, seq_member, length;
   char *data;
 
   /* determine the input source in which the copy patterns starts */
-  seq_length = *seq_member;
-  while (*seq_member >= 0)
-    {
-      index = op->input.sequence.member[*seq_member];
-      input_source = &(op->input.source[index]);
-
-      if (input_source->start_offset <= start_offset)
-        {
-          break;
-        }
-      else
-        {
-          if (*seq_member != 0) (*seq_member)--;
-        }
-    }
-  tmp_seq_member = *seq_member;
-  seq_length = seq_length - *seq_member;
+  seq_member = flott_input_find_member (op, start_offset);
+  index = op->input.sequence.member[seq_member];
+  input_source = &(op->input.source[index]);
 
   /* write copy pattern to output device */
   while (count > 0)
@@ -599,41 +810,81 @@ flott_input_write (flott_object *op, size_t start_offset,
         }
 
       if ( input_source->storage_type
-           & (FLOTT_DEV_MEM | FLOTT_DEV_DEALLOC_MEM
-              | FLOTT_DEV_FILE_TO_MEM | FLOTT_DEV_STOP_SYMBOL) )
+           & (FLOTT_DEV_MEM | FLOTT_DEV_DEALLOC_MEM | FLOTT_DEV_FILE_TO_MEM
+              | FLOTT_DEV_MMAP | FLOTT_DEV_STOP_SYMBOL) )
         {
           data = &(input_source->data.bytes[data_offset]);
           fwrite (data, sizeof (char), data_length, output_handle);
         }
-      else if (input_source->storage_type == FLOTT_DEV_FILE)
+      else if (input_source->storage_type
+               & (FLOTT_DEV_FILE | FLOTT_DEV_CALLBACK))
         {
-          source_handle = input_source->data.handle;
-          if (source_handle == NULL)
+          if (_private->input_window == NULL)
             {
-              /*TODO check for error*/
-              source_handle = fopen (input_source->path, "rb");
-              input_source->data.handle = source_handle;
+              _private->input_window =
+                  (char *) flott_allocate (op->allocator, FLOTT_INPUT_WINDOW);
+              _private->window_source = NULL;
             }
-          data = _private->output_buffer;
-          /* set file offset from which to read */
-          /*TODO check if handle NULL, error out */
-          fseek (source_handle, data_offset, SEEK_SET);
-          while (true)
+          data = _private->input_window;
+
+          while (data_length > 0 && data != NULL)
             {
-              if (data_length > FLOTT_PAGE_SIZE)
-                {
-                  /* TODO: error check */
-                  fread (data, sizeof (char), FLOTT_PAGE_SIZE, source_handle);
-                  fwrite (data, sizeof (char), FLOTT_PAGE_SIZE, output_handle);
-                  data_length -= FLOTT_PAGE_SIZE;
-                }
-              else
+              /* copy patterns are visited right-to-left, hence read windows
+               * that end at the copy pattern, to serve the ones to come */
+              if ( _private->window_source != input_source
+                   || data_offset < _private->window_offset
+                   || data_offset >= _private->window_offset
+                                     + _private->window_length )
                 {
-                  /* TODO: error check */
-                  fread (data, sizeof (char), data_length, source_handle);
-                  fwrite (data, sizeof (char), data_length, output_handle);
-                  break;
+                  length = flott_min_M (data_length, FLOTT_INPUT_WINDOW);
+                  _private->window_offset =
+                      (data_offset + length > FLOTT_INPUT_WINDOW)
+                      ? data_offset + length - FLOTT_INPUT_WINDOW : 0;
+                  _private->window_length = 0;
+                  _private->window_source = input_source;
+
+                  if (input_source->storage_type == FLOTT_DEV_CALLBACK)
+                    {
+                      /* decode window through the user reader */
+                      if (input_source->data.reader->pread != NULL)
+                        {
+                          _private->window_length =
+                              input_source->data.reader->pread (
+                                  input_source->user, data,
+                                  flott_min_M (FLOTT_INPUT_WINDOW,
+                                               input_source->length
+                                               - _private->window_offset),
+                                  _private->window_offset);
+                        }
+                    }
+                  else
+                    {
+                      /*TODO check if handle NULL, error out */
+                      source_handle = flott_input_open (op, input_source);
+                      if (source_handle != NULL
+                          && fseek (source_handle,
+                                    (long) _private->window_offset,
+                                    SEEK_SET) == 0)
+                        {
+                          _private->window_length =
+                              fread (data, sizeof (char), FLOTT_INPUT_WINDOW,
+                                     source_handle);
+                        }
+                    }
+                  if (data_offset >= _private->window_offset
+                                     + _private->window_length)
+                    {
+                      break; /* TODO: error out, read failed */
+                    }
                 }
+
+              length = flott_min_M (data_length,
+                                    _private->window_offset
+                                    + _private->window_length - data_offset);
+              fwrite (&data[data_offset - _private->window_offset],
+                      sizeof (char), length, output_handle);
+              data_offset += length;
+              data_length -= length;
             }
         }
       else
@@ -644,543 +895,114 @@ flott_input_write (flott_object *op, size_t start_offset,
       /* if needed, continue with next input source */
       if (count != 0)
         {
-          index = op->input.sequence.member[++tmp_seq_member];
+          index = op->input.sequence.member[++seq_member];
           input_source = &(op->input.source[index]);
           start_offset = input_source->start_offset;
         }
     }
-
-  /* close file handles of open, no longer needed files */
-  while (seq_length > 0)
-    {
-      index = op->input.sequence.member[*seq_member + seq_length--];
-      input_source = &(op->input.source[index]);
-      if (input_source->storage_type == FLOTT_DEV_FILE
-          && input_source->data.handle != NULL)
-        {
-          fclose (input_source->data.handle);
-          input_source->data.handle = NULL;
-        }
-
-    }
 }
 
-void
-flott_t_transform_callback (flott_object *op)
+int
+flott_get_observer_policy (const flott_object *op)
 {
-  flott_token* cp_last;
-  void *bp = op->_private.base_pointer;
-  double t_complexity = 0.0; ///< holds sum resulting in t-complexity
-  int terminate = false;
-
-  flott_token_list *tl_header = &(op->_private.token_list);
-  flott_uint tl_length = tl_header->length;
-
-  flott_token *tl_bp = (flott_token *) bp;
-  flott_match_list *ml_header_bp = (flott_match_list *) bp;
-
-  flott_match_list *cp_ml_header, *aggregate_ml_header;
-
-  flott_token *cp_token, *first_cp_match, *last_cp_match,
-              *aggregate_token, *ml_token, *al_token;
-
-  size_t cp_uid, cp_length, sl_token_offset,
-         aggregate_token_offset, aggregate_token_length,
-         al_header_offset, al_token_offset,
-         joined_cp, joined_cp_length;
-
-  flott_uint cf_value;
-  ptrdiff_t ml_slot_offset;
-
-  flott_uint tl_progress_length = tl_length;
-  flott_uint tl_progress_dec = tl_length >> 6; ///< divide by 64
-
-  flott_uint level = 0; ///< t-augmentation level
+  int policy = FLOTT_OBSERVE_NONE;
+
+  if (op->handler.progress != NULL) policy |= FLOTT_OBSERVE_PROGRESS;
+  if (op->handler.step != NULL) policy |= FLOTT_OBSERVE_STEP;
+  if (op->boundary.enabled == true) policy |= FLOTT_OBSERVE_BOUNDARY;
+  if (op->statistics.enabled == true) policy |= FLOTT_OBSERVE_STATS;
+  if (op->handler.record != NULL && op->step_buffer.record != NULL
+      && op->step_buffer.size > 0) policy |= FLOTT_OBSERVE_RECORD;
+  if (op->profile.point != NULL && op->profile.size > 0)
+    policy |= FLOTT_OBSERVE_PROFILE;
+
+  return policy;
+}
 
-  /* get pointer to copy pattern token of t-augmentation level zero */
-  sl_token_offset = tl_header->second_last_token;
-  cp_token = flott_get_ptr_M (tl_bp, sl_token_offset);
+/**
+ * out-of-core workspace: the t-transform parses right-to-left and never gets
+ * back to the tokens right of the copy pattern of the current level. Drop the
+ * pages behind the parse (which saves writing them back) and have the OS read
+ * the step ahead of it, which forward read-ahead would not do. Returns the
+ * token offset that triggers the next call (0: none).
+ */
+static size_t
+flott_release_scratch (flott_object *op, size_t token_offset,
+                       size_t token_size)
+{
+  char *bp = (char *) op->_private.base_pointer;
+  size_t live_end = ((token_offset + 1) * token_size + FLOTT_PAGE_SIZE - 1)
+                    & ~((size_t) FLOTT_PAGE_SIZE - 1);
+  size_t ahead = flott_min_M (live_end, FLOTT_SCRATCH_STEP);
 
-  while (tl_length > 0)
+  if (live_end < op->_private.scratch_end)
     {
-      /* call t-transform progress handler function */
-      if (tl_progress_length >= tl_length)
-        {
-          if (tl_progress_length < tl_progress_dec)
-            {
-              tl_progress_length = 0;
-            }
-          else
-            {
-              tl_progress_length -= tl_progress_dec;
-            }
-          if (op->handler.progress != NULL)
-            {
-              op->handler.progress (op,
-                  (1 - (float) tl_length / tl_header->length));
-            }
-        }
-
-      /* increment t-augmentation level */
-      level++;
-
-      /* get length and unique id (uid) of copy pattern token */
-      cp_length = sl_token_offset - cp_token->previous_token;
-      cp_uid = cp_token->uid;
-      cp_last = cp_token;
-
-      /* move pointer to token to the left of the copy pattern */
-      cp_token = flott_get_ptr_M (tl_bp, cp_token->previous_token);
-
-      /* get match list header assigned to copy pattern and match list length */
-      cp_ml_header = flott_get_ptr_M (ml_header_bp, cp_uid);
-
-      /* determine copy factor and remove the run of copy pattern tokens
-       * from token and match list.
-       * (right-to-left parsing step) */
-      cf_value = 1;
-      joined_cp_length = cp_length;
-      while (cp_token->uid == (flott_uint) cp_uid)
-        {
-          cf_value++;
-          joined_cp_length += cp_length;
-          cp_token -= cp_length;
-        }
-
-      /* update t-complexity value for t-augmentation step */
-      t_complexity += flott_log2_M (cf_value + 1);
-
-      /* call t-transform step handler function*/
-      if (op->handler.step != NULL)
-        {
-          op->handler.step (op, cp_last, level, cf_value,
-                            (sl_token_offset - cp_length),
-                            cp_length, joined_cp_length,
-                            t_complexity,  &terminate);
-          if (terminate == true) break; ///< terminate early
-        }
-
-      sl_token_offset -= joined_cp_length;
-
-      /* update list lengths, since the above copy pattern tokens are located
-       * at the end of their match and the end of the token list it is
-       * sufficient to just update the list length, i.e. there is no need to
-       * update 'previous' and 'next' offsets */
-      tl_length -= cf_value;
-      cp_ml_header->length -= cf_value;
-
-      if (cp_ml_header->length == 0)
-        {
-          continue;
-        }
-
-      /* scan from left-to-right, chain up the maximum number of copy
-       * patterns, and merge the run of copy patterns with the immediately
-       * following token into a new aggregate token. */
-      while (cp_ml_header->length > 0)
-        {
-          first_cp_match = flott_get_ptr_M (tl_bp, cp_ml_header->first_match);
-          last_cp_match = first_cp_match;
-
-          /* join the maximum number of copy pattern tokens */
-          joined_cp = 1;
-          joined_cp_length = cp_length;
-
-          while (last_cp_match->next_token == last_cp_match->next_match
-                 && joined_cp < cf_value)
-            {
-              joined_cp++;
-              joined_cp_length += cp_length;
-
-              /* initialize the augmentation level and length of possible
-               * new aggregate match list headers */
-              ((flott_match_list *) last_cp_match)->level = level;
-              ((flott_match_list *) last_cp_match)->length = 0;
-
-              last_cp_match += cp_length;
-            }
-          cp_ml_header->length -= (flott_uint) joined_cp;
-          tl_length -= (flott_uint) joined_cp;
-
-          /* remove joined copy patterns form match list */
-          cp_ml_header->first_match = last_cp_match->next_match;
-
-          /* determine aggregate token */
-          aggregate_token_offset = last_cp_match->next_token;
-          aggregate_token = flott_get_ptr_M (tl_bp, aggregate_token_offset);
-          aggregate_token_length = aggregate_token_offset
-                                       - aggregate_token->previous_token;
-
-          /* update token list offsets to include the aggregate token */
-          aggregate_token->previous_token = first_cp_match->previous_token;
-
-          /* update previous token list token */
-          (first_cp_match - cp_length)->next_token =
-              (flott_uint) aggregate_token_offset;
-
-          /* get match list header for aggregate token */
-          al_header_offset = (size_t) (aggregate_token->uid);
-          aggregate_ml_header = flott_get_ptr_M (ml_header_bp, al_header_offset);
-
-          /* remove aggregate token from its former match list */
-          (aggregate_ml_header->length)--;
-          if ( (aggregate_ml_header->first_match == aggregate_token_offset)
-               || al_header_offset == cp_uid )
-            {
-              /* removal from head if former match list */
-              aggregate_ml_header->first_match = aggregate_token->next_match;
-            }
-          else
-            {
-              ml_token =
-                  flott_get_ptr_M (tl_bp, aggregate_token->previous_match);
-              ml_token->next_match = aggregate_token->next_match;
-
-              ml_token =
-                  flott_get_ptr_M (tl_bp, aggregate_token->next_match);
-              ml_token->previous_match = aggregate_token->previous_match;
-            }
-
-          /* determine new match list and uid for aggregate token */
-          while (true)
-            {
-              /* first time we have generated the aggregate token */
-              if (aggregate_ml_header->level != level)
-                {
-                  /* set offset to next aggregate match list */
-                  aggregate_ml_header->level = level;
-                  aggregate_ml_header->next_aggregate =
-                      (flott_uint) aggregate_token_offset;
-
-                  /* initialize new match list and append aggregate token */
-                  aggregate_ml_header = (flott_match_list *) last_cp_match;
-                  aggregate_ml_header->level = 0;
-                  aggregate_ml_header->length = 1;
-                  aggregate_ml_header->first_match =
-                      (flott_uint) aggregate_token_offset;
-                  aggregate_ml_header->last_match =
-                      (flott_uint) aggregate_token_offset;
-
-                  /* update aggregate token info */
-                  aggregate_token->previous_match = FLOTT_NIL;
-                  aggregate_token->next_match = FLOTT_NIL;
-                  aggregate_token->uid = (flott_uint) (aggregate_token_offset
-                                             - aggregate_token_length);
-
-                  break;
-                }
-              else /* we might have generated the aggregate token before */
-                {
-                  al_token_offset = (size_t) (aggregate_ml_header->next_aggregate);
-                  al_token = flott_get_ptr_M (tl_bp, al_token_offset);
-
-                  /* check if we have a match list already */
-                  ml_slot_offset = (ptrdiff_t) (al_token->previous_token)
-                                   + (ptrdiff_t) (joined_cp_length);
-
-                  if ( ( (ptrdiff_t) (al_token->uid) - ml_slot_offset ) >= 0 )
-                    {
-                      aggregate_ml_header =
-                          flott_get_ptr_M (ml_header_bp, ml_slot_offset);
-
-                      /* append aggregate token to its match list */
-                      if (aggregate_ml_header->length == 0)
-                      {
-                          aggregate_ml_header->first_match =
-                              (flott_uint) aggregate_token_offset;
+      flott_discard_pages (bp + live_end, op->_private.scratch_end - live_end);
+      op->_private.scratch_end = live_end;
+    }
+  flott_advise_file (bp + live_end - ahead, ahead, FLOTT_ADVISE_WILLNEED);
 
-                          aggregate_token->previous_match = FLOTT_NIL;
-                      }
-                      else
-                      {
-                          ml_token =
-                              flott_get_ptr_M (tl_bp,
-                                               aggregate_ml_header->last_match);
-                          ml_token->next_match =
-                              (flott_uint) aggregate_token_offset;
+  return (live_end > FLOTT_SCRATCH_STEP / 2)
+         ? (live_end - FLOTT_SCRATCH_STEP / 2) / token_size : 0;
+}
 
-                          aggregate_token->previous_match =
-                              aggregate_ml_header->last_match;
+/**
+ * set up the release steps of an out-of-core workspace; the match lists are
+ * chased all over the workspace, so there is no read-ahead beyond the steps
+ */
+static size_t
+flott_prepare_scratch (flott_object *op)
+{
+  size_t token_size = flott_get_token_size (op->_private.offset_type);
 
-                          aggregate_ml_header->last_match =
-                              (flott_uint) aggregate_token_offset;
-                      }
-                      aggregate_ml_header->last_match =
-                          (flott_uint) aggregate_token_offset;
-                      (aggregate_ml_header->length)++;
+  /* the page holding the tail node and the level-zero match list headers
+   * right of it stay in use until the end */
+  op->_private.scratch_end = ((op->_private.token_list.length + 1)
+                              * token_size) & ~((size_t) FLOTT_PAGE_SIZE - 1);
+  flott_advise_file ((char *) op->_private.base_pointer,
+                     op->_private.allocation_size, FLOTT_ADVISE_RANDOM);
 
-                      /* update aggregate token info */
-                      aggregate_token->next_match = FLOTT_NIL;
-                      aggregate_token->uid = (flott_uint) (ml_slot_offset);
+  return flott_release_scratch (op, op->_private.token_list.second_last_token,
+                                token_size);
+}
 
-                      break;
-                    }
+void
+flott_t_transform_policy (flott_object *op, int policy)
+{
+  policy &= (FLOTT_OBSERVE_POLICIES - 1);
 
-                  /* no match list found, loop and check next aggregate offset */
-                  aggregate_ml_header =
-                      flott_get_ptr_M (ml_header_bp, al_token->uid);
-                }
-            }
-        }
-    }
+  op->_private.scratch_release = (op->_private.backing
+                                  == FLOTT_BACKING_SCRATCH)
+                                 ? flott_prepare_scratch (op) : 0;
 
-  /* update progress bar to 100% done */
-  if (op->handler.progress != NULL)
+  switch (op->_private.offset_type)
     {
-      op->handler.progress (op, 1.0);
+      case FLOTT_OFFSET_16BIT : flott_t_transform_lut_16[policy] (op); break;
+      case FLOTT_OFFSET_64BIT : flott_t_transform_lut_64[policy] (op); break;
+      default : flott_t_transform_lut_32[policy] (op); break;
     }
+}
 
-  /* set results for levels, t-complexity, t-information, t-entropy */
-  op->result.levels = level;
-  op->result.t_complexity = t_complexity;
-  op->result.t_information = flott_get_t_information (t_complexity);
-  op->result.t_entropy = op->result.t_information / (tl_header->length + 1);
+void
+flott_t_transform_callback (flott_object *op)
+{
+  /* handlers may be (un)set from within a callback, always observe them */
+  flott_t_transform_policy (op, flott_get_observer_policy (op)
+                                | FLOTT_OBSERVE_PROGRESS | FLOTT_OBSERVE_STEP);
 }
 
 void
 flott_t_transform_simple (flott_object *op)
 {
-  void *bp = op->_private.base_pointer;
-  double t_complexity = 0.0; ///< holds sum resulting in t-complexity
-
-  flott_token_list *tl_header = &(op->_private.token_list);
-  flott_uint tl_length = tl_header->length;
-
-  flott_token *tl_bp = (flott_token *) bp;
-  flott_match_list *ml_header_bp = (flott_match_list *) bp;
-
-  flott_match_list *cp_ml_header, *aggregate_ml_header;
-
-  flott_token *cp_token, *first_cp_match, *last_cp_match,
-              *aggregate_token, *ml_token, *al_token;
-
-  size_t cp_uid, cp_length, sl_token_offset,
-         aggregate_token_offset, aggregate_token_length,
-         al_header_offset, al_token_offset,
-         joined_cp, joined_cp_length;
-
-  flott_uint cf_value;
-  ptrdiff_t ml_slot_offset;
-
-  flott_uint level = 0; ///< t-augmentation level
-
-  /* get pointer to copy pattern token of t-augmentation level zero */
-  sl_token_offset = tl_header->second_last_token;
-  cp_token = flott_get_ptr_M (tl_bp, sl_token_offset);
-
-  while (tl_length > 0)
-    {
-      /* increment t-augmentation level */
-      level++;
-
-      /* get length and unique id (uid) of copy pattern token */
-      cp_length = sl_token_offset - cp_token->previous_token;
-      cp_uid = cp_token->uid;
-
-      /* move pointer to token to the left of the copy pattern */
-      cp_token = flott_get_ptr_M (tl_bp, cp_token->previous_token);
-
-      /* get match list header assigned to copy pattern and match list length */
-      cp_ml_header = flott_get_ptr_M (ml_header_bp, cp_uid);
-
-      /* determine copy factor and remove the run of copy pattern tokens
-       * from token and match list.
-       * (right-to-left parsing step) */
-      cf_value = 1;
-      joined_cp_length = cp_length;
-      while (cp_token->uid == (flott_uint) cp_uid)
-        {
-          cf_value++;
-          joined_cp_length += cp_length;
-          cp_token -= cp_length;
-        }
-
-      /* update t-complexity value for t-augmentation step */
-      t_complexity += flott_log2_M (cf_value + 1);
-
-      sl_token_offset -= joined_cp_length;
-
-      /* update list lengths, since the above copy pattern tokens are located
-       * at the end of their match and the end of the token list it is
-       * sufficient to just update the list length, i.e. there is no need to
-       * update 'previous' and 'next' offsets */
-      tl_length -= cf_value;
-      cp_ml_header->length -= cf_value;
-
-      if (cp_ml_header->length == 0)
-        {
-          continue;
-        }
-
-      /* scan from left-to-right, chain up the maximum number of copy
-       * patterns, and merge the run of copy patterns with the immediately
-       * following token into a new aggregate token. */
-      while (cp_ml_header->length > 0)
-        {
-          first_cp_match = flott_get_ptr_M (tl_bp, cp_ml_header->first_match);
-          last_cp_match = first_cp_match;
-
-          /* join the maximum number of copy pattern tokens */
-          joined_cp = 1;
-          joined_cp_length = cp_length;
-
-          while (last_cp_match->next_token == last_cp_match->next_match
-                 && joined_cp < cf_value)
-            {
-              joined_cp++;
-              joined_cp_length += cp_length;
-
-              /* initialize the augmentation level and length of possible
-               * new aggregate match list headers */
-              ((flott_match_list *) last_cp_match)->level = level;
-              ((flott_match_list *) last_cp_match)->length = 0;
-
-              last_cp_match += cp_length;
-            }
-          cp_ml_header->length -= (flott_uint) joined_cp;
-          tl_length -= (flott_uint) joined_cp;
-
-          /* remove joined copy patterns form match list */
-          cp_ml_header->first_match = last_cp_match->next_match;
-
-          /* determine aggregate token */
-          aggregate_token_offset = last_cp_match->next_token;
-          aggregate_token = flott_get_ptr_M (tl_bp, aggregate_token_offset);
-          aggregate_token_length = aggregate_token_offset
-                                       - aggregate_token->previous_token;
-
-          /* update token list offsets to include the aggregate token */
-          aggregate_token->previous_token = first_cp_match->previous_token;
-
-          /* update previous token list token */
-          (first_cp_match - cp_length)->next_token =
-              (flott_uint) aggregate_token_offset;
-
-          /* get match list header for aggregate token */
-          al_header_offset = (size_t) (aggregate_token->uid);
-          aggregate_ml_header = flott_get_ptr_M (ml_header_bp, al_header_offset);
-
-          /* remove aggregate token from its former match list */
-          (aggregate_ml_header->length)--;
-          if ( (aggregate_ml_header->first_match == aggregate_token_offset)
-               || al_header_offset == cp_uid )
-            {
-              /* removal from head if former match list */
-              aggregate_ml_header->first_match = aggregate_token->next_match;
-            }
-          else
-            {
-              ml_token =
-                  flott_get_ptr_M (tl_bp, aggregate_token->previous_match);
-              ml_token->next_match = aggregate_token->next_match;
-
-              ml_token =
-                  flott_get_ptr_M (tl_bp, aggregate_token->next_match);
-              ml_token->previous_match = aggregate_token->previous_match;
-            }
-
-          /* determine new match list and uid for aggregate token */
-          while (true)
-            {
-              /* first time we have generated the aggregate token */
-              if (aggregate_ml_header->level != level)
-                {
-                  /* set offset to next aggregate match list */
-                  aggregate_ml_header->level = level;
-                  aggregate_ml_header->next_aggregate =
-                      (flott_uint) aggregate_token_offset;
-
-                  /* initialize new match list and append aggregate token */
-                  aggregate_ml_header = (flott_match_list *) last_cp_match;
-                  aggregate_ml_header->level = 0;
-                  aggregate_ml_header->length = 1;
-                  aggregate_ml_header->first_match =
-                      (flott_uint) aggregate_token_offset;
-                  aggregate_ml_header->last_match =
-                      (flott_uint) aggregate_token_offset;
-
-                  /* update aggregate token info */
-                  aggregate_token->previous_match = FLOTT_NIL;
-                  aggregate_token->next_match = FLOTT_NIL;
-                  aggregate_token->uid = (flott_uint) (aggregate_token_offset
-                                             - aggregate_token_length);
-
-                  break;
-                }
-              else /* we might have generated the aggregate token before */
-                {
-                  al_token_offset = (size_t) (aggregate_ml_header->next_aggregate);
-                  al_token = flott_get_ptr_M (tl_bp, al_token_offset);
-
-                  /* check if we have a match list already */
-                  ml_slot_offset = (ptrdiff_t) (al_token->previous_token)
-                                   + (ptrdiff_t) (joined_cp_length);
-
-                  if ( ( (ptrdiff_t) (al_token->uid) - ml_slot_offset ) >= 0 )
-                    {
-                      aggregate_ml_header =
-                          flott_get_ptr_M (ml_header_bp, ml_slot_offset);
-
-                      /* append aggregate token to its match list */
-                      if (aggregate_ml_header->length == 0)
-                      {
-                          aggregate_ml_header->first_match =
-                              (flott_uint) aggregate_token_offset;
-
-                          aggregate_token->previous_match = FLOTT_NIL;
-                      }
-                      else
-                      {
-                          ml_token =
-                              flott_get_ptr_M (tl_bp,
-                                               aggregate_ml_header->last_match);
-                          ml_token->next_match =
-                              (flott_uint) aggregate_token_offset;
-
-                          aggregate_token->previous_match =
-                              aggregate_ml_header->last_match;
-
-                          aggregate_ml_header->last_match =
-                              (flott_uint) aggregate_token_offset;
-                      }
-                      aggregate_ml_header->last_match =
-                          (flott_uint) aggregate_token_offset;
-                      (aggregate_ml_header->length)++;
-
-                      /* update aggregate token info */
-                      aggregate_token->next_match = FLOTT_NIL;
-                      aggregate_token->uid = (flott_uint) (ml_slot_offset);
-
-                      break;
-                    }
-
-                  /* no match list found, loop and check next aggregate offset */
-                  aggregate_ml_header =
-                      flott_get_ptr_M (ml_header_bp, al_token->uid);
-                }
-            }
-        }
-    }
-
-  /* set results for levels, t-complexity, t-information, t-entropy */
-  op->result.levels = level;
-  op->result.t_complexity = t_complexity;
-  op->result.t_information = flott_get_t_information (t_complexity);
-  op->result.t_entropy = op->result.t_information / (tl_header->length + 1);
+  /* no use of observers (fastest) */
+  flott_t_transform_policy (op, FLOTT_OBSERVE_NONE);
 }
 
 void
 flott_t_transform (flott_object *op)
 {
-  if (op->handler.progress != NULL || op->handler.step != NULL)
-    {
-      flott_t_transform_callback (op);
-    }
-  else
-    {
-      /* no use of callback functions (faster) */
-      flott_t_transform_simple (op);
-    }
+  /* only pay for the observers that are actually in use */
+  flott_t_transform_policy (op, flott_get_observer_policy (op));
 }
 
 void
@@ -1291,11 +1113,16 @@ flott_deinitialize (flott_object *op)
   flott_source *source;
   if (op != NULL)
     {
-      if (op->_private.base_pointer != NULL)
-      {
-        free (op->_private.base_pointer);
-        op->_private.base_pointer = NULL;
-      }
+      /* a lent workspace stays with the object for the next input */
+      if (op->_private.borrowed == false)
+        {
+          flott_release_workspace (op);
+        }
+
+      /* the read window is kept for the next input (freed on destroy) */
+      op->_private.window_source = NULL;
+      flott_prefetch_release (op);
+      flott_input_close (op);
 
       if (op->input.source != NULL)
       {
@@ -1308,6 +1135,11 @@ flott_deinitialize (flott_object *op)
                 fclose (source->data.handle);
                 source->data.handle = NULL;
               }
+            else if (source->storage_type == FLOTT_DEV_MMAP)
+              {
+                flott_unmap_file (source->data.bytes, source->length);
+                source->data.bytes = NULL;
+              }
           }
       }
     }
@@ -1325,6 +1157,7 @@ flott_destroy (flott_object *op)
         {
           op->handler.destroy (op);
         }
+      flott_input_close (op);
 
       if (op->input.deallocate == true)
         {
@@ -1338,7 +1171,7 @@ flott_destroy (flott_object *op)
                     {
                       if (source->data.bytes != NULL)
                       {
-                          free (source->data.bytes);
+                          flott_deallocate (op->allocator, source->data.bytes);
                       }
                     }
                   else if (source->storage_type == FLOTT_DEV_FILE
@@ -1346,18 +1179,25 @@ flott_destroy (flott_object *op)
                     {
                       fclose (source->data.handle);
                     }
+                  else if (source->storage_type == FLOTT_DEV_MMAP)
+                    {
+                      flott_unmap_file (source->data.bytes, source->length);
+                    }
                 }
-              free (op->input.source);
+              flott_deallocate (op->allocator, op->input.source);
             }
 
           if (op->input.sequence.deallocate == true)
             {
-              free (op->input.sequence.member);
+              flott_deallocate (op->allocator, op->input.sequence.member);
             }
         }
-      if (op->_private.base_pointer != NULL) free (op->_private.base_pointer);
+      flott_release_workspace (op);
+      flott_prefetch_release (op);
+      flott_deallocate (op->allocator, op->_private.input_window);
+      flott_deallocate (op->allocator, op->_private.init_chunk);
 
-      free (op);
+      flott_deallocate (op->allocator, op);
       op = NULL;
     }
 }
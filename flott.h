@@ -29,6 +29,7 @@ extern "C" {
 #include "flott_config.h"
 #include "flott_error.h"
 #include "flott_lang.h"
+#include "flott_util.h"
 
 /**
  * constant 'define' macros
@@ -36,8 +37,29 @@ extern "C" {
 #define FLOTT_PAGE_SIZE 4096        ///< use pages of 4K size
 #define FLOTT_NIL 0                 ///< terminating offset value for linked lists
 #define FLOTT_UINT_MAX UINT32_MAX   ///< maximum addressable token memory units
+#define FLOTT_UINT16_MAX UINT16_MAX ///< ditto, for the 16-bit offset engine
+#define FLOTT_UINT64_MAX UINT64_MAX ///< ditto, for the 64-bit offset engine
 #define FLOTT_LINE_BUFSZ 1024       ///< size of line (text) buffer
 #define FLOTT_STOP_SYMBOL 256
+#define FLOTT_CF_HISTOGRAM_SIZE 64  ///< copy factor buckets (0: overflow)
+#define FLOTT_CF_TAIL_SIZE 32       ///< distinct overflow copy factors counted
+#define FLOTT_INIT_CHUNK_MIN (1 << 20) ///< min. symbols per parallel init chunk
+#define FLOTT_READ_AHEAD_SIZE (1 << 20) ///< file read-ahead buffer size in bytes
+#define FLOTT_INPUT_HANDLES 16      ///< max. files kept open by 'flott_input_write'
+#define FLOTT_INPUT_WINDOW (1 << 16) ///< read window of 'flott_input_write'
+
+/**
+ * t-transform observer policy bits, the t-transform is instantiated at
+ * compile time for each combination (see 'flott_transform.def')
+ */
+#define FLOTT_OBSERVE_NONE     0x00 ///< no observers (fastest)
+#define FLOTT_OBSERVE_PROGRESS 0x01 ///< call progress handler
+#define FLOTT_OBSERVE_STEP     0x02 ///< call step handler on each level
+#define FLOTT_OBSERVE_BOUNDARY 0x04 ///< capture t-complexity at a boundary
+#define FLOTT_OBSERVE_STATS    0x08 ///< collect t-transform statistics
+#define FLOTT_OBSERVE_RECORD   0x10 ///< write step records to a buffer
+#define FLOTT_OBSERVE_PROFILE  0x20 ///< write suffix t-complexity profile
+#define FLOTT_OBSERVE_POLICIES 64   ///< number of policy combinations
 
 /**
  * function macros (indicated by '_M' suffix)
@@ -48,30 +70,50 @@ extern "C" {
 #define flott_bitset_M(field, bit) (((field) & bit) == bit)
 #define flott_min_M(a, b) (((a) < (b)) ? (a) : (b))
 #define flott_max_M(a, b) (((a) > (b)) ? (a) : (b))
+#define flott_paste_M(a, b) a ## b
+#define flott_concat_M(a, b) flott_paste_M (a, b)
 
 /**
  * data type definitions
  */
 typedef uint32_t flott_uint;
+typedef uint16_t flott_uint16;
+typedef uint64_t flott_uint64;
 
 typedef enum flott_vlevel flott_vlevel;
 typedef enum flott_symbol_type flott_symbol_type;
 typedef enum flott_storage_type flott_storage_type;
+typedef enum flott_offset_type flott_offset_type;
 typedef enum flott_mode flott_mode;
 
 typedef struct flott_token flott_token;
 typedef struct flott_match_list flott_match_list;
+typedef struct flott_token16 flott_token16;
+typedef struct flott_match_list16 flott_match_list16;
+typedef struct flott_token64 flott_token64;
+typedef struct flott_match_list64 flott_match_list64;
 typedef struct flott_token_list flott_token_list;
 
 typedef struct flott_source flott_source;
+typedef struct flott_reader flott_reader;
 typedef struct flott_sequence flott_sequence;
 typedef struct flott_input flott_input;
 typedef struct flott_result flott_result;
 typedef struct flott_retain flott_retain;
 typedef struct flott_handler flott_handler;
+typedef struct flott_boundary flott_boundary;
+typedef struct flott_statistics flott_statistics;
+typedef struct flott_step_record flott_step_record;
+typedef struct flott_step_buffer flott_step_buffer;
+typedef struct flott_profile_point flott_profile_point;
+typedef struct flott_profile flott_profile;
+typedef struct flott_window flott_window;
+typedef struct flott_scratch flott_scratch;
 typedef struct flott_status flott_status;
 typedef struct flott_private flott_private;
 typedef struct flott_object flott_object;
+typedef struct flott_cache flott_cache;
+typedef struct flott_workspace flott_workspace;
 
 /**
  * function pointer type definitions
@@ -82,9 +124,15 @@ typedef void (flott_destroy_handler) (const flott_object *);
 typedef void (flott_error_handler) (flott_object *, int *);
 typedef void (flott_message_handler) (flott_object *, flott_vlevel, int *);
 typedef void (flott_progress_handler) (const flott_object *, const float);
-typedef void (flott_step_handler) (flott_object *, flott_token *, const flott_uint,
+typedef void (flott_step_handler) (flott_object *, void *, const size_t,
                                    const size_t, const size_t, const size_t,
                                    const size_t, const double, int *);
+typedef void (flott_record_handler) (flott_object *, const flott_step_record *,
+                                     const size_t, int *);
+typedef void (flott_window_handler) (flott_object *, const size_t,
+                                     const flott_result *, int *);
+typedef size_t (flott_read_handler) (void *, char *, size_t);
+typedef size_t (flott_pread_handler) (void *, char *, size_t, size_t);
 /**
  * verbosity levels
  */
@@ -112,7 +160,21 @@ enum flott_storage_type
   FLOTT_DEV_FILE_TO_MEM  = 1 << 3,  ///< read file into memory
   FLOTT_DEV_FILE         = 1 << 4,  ///< read/write from/to file
   FLOTT_DEV_STDOUT       = 1 << 5,  ///< standard out
-  FLOTT_DEV_STOP_SYMBOL  = 1 << 6   ///< stop symbol (future use -- not implemented yet)
+  FLOTT_DEV_STOP_SYMBOL  = 1 << 6,  ///< stop symbol (future use -- not implemented yet)
+  FLOTT_DEV_MMAP         = 1 << 7,  ///< memory map file (read only, zero-copy)
+  FLOTT_DEV_STREAM       = 1 << 8,  ///< read pipe/stdin until end of stream
+  FLOTT_DEV_CALLBACK     = 1 << 9   ///< read through user callbacks (decoders)
+};
+
+/**
+ * token offset width of the t-transform engine (value is size of an offset
+ * in bytes); selected by 'flott_initialize' according to the input length
+ */
+enum flott_offset_type
+{
+  FLOTT_OFFSET_16BIT = 2,  ///< 16-bit offsets (short inputs)
+  FLOTT_OFFSET_32BIT = 4,  ///< 32-bit offsets (default)
+  FLOTT_OFFSET_64BIT = 8   ///< 64-bit offsets (inputs beyond 4G tokens)
 };
 
 struct flott_retain
@@ -143,11 +205,47 @@ struct flott_match_list
   flott_uint last_match;       ///< last entry in match list
 };
 
+struct flott_token16
+{
+  flott_uint16 uid;            ///< unique id field
+  flott_uint16 previous_match; ///< offset to previous match
+  flott_uint16 next_match;     ///< offset to next match
+  flott_uint16 previous_token; ///< offset to previous token (to left)
+  flott_uint16 next_token;     ///< offset to next token (to right)
+};
+
+struct flott_match_list16
+{
+  flott_uint16 level;          ///< the level in which the list was created
+  flott_uint16 length;         ///< length (number of elements in match list)
+  flott_uint16 next_aggregate; ///< next entry in aggregate list
+  flott_uint16 first_match;    ///< first entry in match list
+  flott_uint16 last_match;     ///< last entry in match list
+};
+
+struct flott_token64
+{
+  flott_uint64 uid;            ///< unique id field
+  flott_uint64 previous_match; ///< offset to previous match
+  flott_uint64 next_match;     ///< offset to next match
+  flott_uint64 previous_token; ///< offset to previous token (to left)
+  flott_uint64 next_token;     ///< offset to next token (to right)
+};
+
+struct flott_match_list64
+{
+  flott_uint64 level;          ///< the level in which the list was created
+  flott_uint64 length;         ///< length (number of elements in match list)
+  flott_uint64 next_aggregate; ///< next entry in aggregate list
+  flott_uint64 first_match;    ///< first entry in match list
+  flott_uint64 last_match;     ///< last entry in match list
+};
+
 struct flott_token_list
 {
-  flott_uint length;            ///< length of token list
-  flott_uint first_token;       ///< offset to first token
-  flott_uint second_last_token; ///< offset to second-last token
+  size_t length;                ///< length of token list
+  size_t first_token;           ///< offset to first token
+  size_t second_last_token;     ///< offset to second-last token
 };
 
 struct flott_sequence
@@ -157,6 +255,22 @@ struct flott_sequence
   size_t *member;
 };
 
+/**
+ * user reader of a 'FLOTT_DEV_CALLBACK' source, set in 'data.reader' with the
+ * reader state in 'user' and the decoded length in 'length'. Both functions
+ * get 'user' and return the number of bytes stored in the buffer, which is
+ * less than requested only at the end of the data. The level-zero lists are
+ * populated straight from the decoded chunks, through 'pread' (from offset 0)
+ * if set, so that the source can be initialized any number of times, or else
+ * through 'read' (single pass). Copy pattern output, sliding windows and the
+ * result cache need 'pread', which may be called from worker threads.
+ */
+struct flott_reader
+{
+  flott_read_handler *read;    ///< read next bytes (user, buffer, capacity)
+  flott_pread_handler *pread;  ///< read at offset (user, buffer, count, offset)
+};
+
 struct flott_source
 {
   size_t length;                    ///< length of source in bytes
@@ -164,7 +278,7 @@ struct flott_source
   size_t end_offset;
   flott_storage_type storage_type;  ///< type of input (i.e HD, memory)
   char *path;
-  union { FILE *handle; char *bytes; } data;
+  union { FILE *handle; char *bytes; const flott_reader *reader; } data;
   void* user;
 };
 
@@ -176,6 +290,8 @@ struct flott_input
     symbol_type;        ///< symbol width in bits
   size_t count;         ///< number of input sources
   size_t length;
+  flott_offset_type
+    offset_type;        ///< min. token offset width (default = 0, narrowest)
   flott_source *source; ///< array holding input descriptors
   flott_sequence
     sequence;           ///< ordered sequence in which input is to be processed
@@ -183,11 +299,63 @@ struct flott_input
 
 struct flott_result
 {
-  flott_uint levels;
-  flott_uint tl_length;
+  size_t levels;
+  size_t tl_length;
   double t_complexity;
   double t_information;
   double t_entropy;
+  size_t cf_histogram[FLOTT_CF_HISTOGRAM_SIZE]; ///< steps per copy factor
+};
+
+struct flott_step_record
+{
+  size_t level;           ///< t-augmentation level
+  size_t copy_factor;     ///< copy factor of copy pattern
+  size_t cp_offset;       ///< start offset of copy pattern
+  size_t cp_length;       ///< length of copy pattern in symbols
+  size_t joined_length;   ///< length of the joined run of copy patterns
+  double t_complexity;    ///< cumulative t-complexity
+};
+
+struct flott_step_buffer
+{
+  flott_step_record
+    *record;              ///< caller supplied step record array
+  size_t size;            ///< capacity of 'record' in records
+};
+
+struct flott_profile_point
+{
+  size_t offset;          ///< copy pattern start offset (see 'cp_offset')
+  double t_complexity;    ///< t-complexity of the suffix parsed so far
+};
+
+struct flott_profile
+{
+  flott_profile_point
+    *point;               ///< caller supplied (or mapped) point array
+  size_t size;            ///< capacity of 'point' (token list length suffices)
+  size_t count;           ///< number of points written by the last t-transform
+};
+
+struct flott_window
+{
+  size_t size;            ///< window size in bytes (default = 0, no window)
+  size_t stride;          ///< distance of window start offsets (0: 'size')
+};
+
+/**
+ * out-of-core t-transform: token workspaces of at least 'threshold' bytes are
+ * mapped onto a temporary file in directory 'path' (local storage, not a
+ * network file system), letting inputs exceed the available memory. The OS
+ * writes dirty workspace pages back as for any file (on Linux once they
+ * exceed 'vm.dirty_background_ratio'), which makes workspaces that would fit
+ * into memory much slower than in memory.
+ */
+struct flott_scratch
+{
+  const char *path;       ///< scratch directory (default = NULL, in memory)
+  size_t threshold;       ///< min. workspace size in bytes (0: any size)
 };
 
 struct flott_handler
@@ -196,10 +364,31 @@ struct flott_handler
   flott_init_handler *init;
   flott_progress_handler *progress;
   flott_step_handler *step;
+  flott_record_handler *record; ///< called whenever the step buffer is full
+  flott_window_handler *window;  ///< called with the result of each window
   flott_message_handler *message;
   flott_error_handler *error;
 };
 
+struct flott_boundary
+{
+  bool enabled;           ///< capture t-complexity at 'offset'
+  size_t offset;          ///< boundary offset in symbols from start of input
+  double t_complexity;    ///< cumulative t-complexity once parse crosses 'offset'
+  size_t count;           ///< number of 'offsets' (0: single boundary 'offset')
+  const size_t *offsets;  ///< boundary offsets, ascending
+  double *t_complexities; ///< cumulative t-complexity at each of 'offsets'
+};
+
+struct flott_statistics
+{
+  bool enabled;           ///< collect statistics during t-transform
+  size_t max_copy_factor; ///< largest copy factor of any level
+  size_t max_cp_length;   ///< longest copy pattern in symbols
+  size_t copy_steps;      ///< number of levels with a copy factor > 1
+  size_t aggregate_tokens;///< number of aggregate tokens generated
+};
+
 struct flott_status
 {
   int code;
@@ -211,13 +400,38 @@ struct flott_private
   void *base_pointer;   ///< base pointer to used memory block (set by init routine)
   double ln2;           ///< ln(2)
 
-  size_t input_sequence_member;
-  char output_buffer[FLOTT_PAGE_SIZE];
+  size_t input_sequence_member; ///< last input sequence member
+  flott_source
+    *open_source[FLOTT_INPUT_HANDLES]; ///< open file sources, most recent first
+  char *input_window;           ///< file read window (allocated on first use)
+  const flott_source
+    *window_source;             ///< source held in 'input_window'
+  size_t window_offset;         ///< source offset of 'input_window'
+  size_t window_length;         ///< valid bytes in 'input_window'
+  void *init_chunk;             ///< chunk state of the parallel level-zero
+                                ///< initialization (allocated on first use)
+  size_t init_chunk_size;       ///< bytes held in 'init_chunk'
+  size_t prefetch_source;       ///< first source not prefetched yet
+  FILE *prefetch_handle[FLOTT_INPUT_HANDLES]; ///< file sources opened ahead,
+  size_t prefetch_index[FLOTT_INPUT_HANDLES]; ///< slot: source index modulo
+                                              ///< FLOTT_INPUT_HANDLES
 
   flott_token_list
     token_list;         ///< header info for token list
-  flott_uint
-    allocation_length;  ///< total memory in token units
+  flott_offset_type
+    offset_type;        ///< token offset width of the engine in use
+  size_t
+    allocation_size;    ///< total memory allocated in bytes
+  bool
+    borrowed;           ///< base pointer memory is owned by the caller
+  flott_backing
+    backing;            ///< memory backing of the workspace
+  size_t
+    scratch_release;    ///< token offset of the next out-of-core release
+  size_t
+    scratch_end;        ///< end of the live out-of-core workspace in bytes
+  size_t
+    stop_symbols;       ///< number of (distinct) stop symbols in the input
 };
 
 struct flott_object
@@ -226,22 +440,60 @@ struct flott_object
   flott_result result;      ///< t-transform result descriptor
   flott_status status;      ///< status codes/messages
   flott_handler handler;    ///< handler function pointers
-  /* TODO: implement sliding window
-   * flott_uint window_size;   ///< size of a sliding window (default = 0, no window) */
+  flott_boundary boundary;  ///< boundary capture (observer)
+  flott_statistics
+    statistics;             ///< t-transform statistics (observer)
+  flott_step_buffer
+    step_buffer;            ///< step record buffer (observer)
+  flott_profile profile;    ///< suffix t-complexity profile (observer)
+  flott_window window;      ///< sliding window (see 'flott_t_transform_window')
+  flott_scratch scratch;    ///< out-of-core workspace (see 'flott_scratch')
   flott_vlevel
     verbosity_level;        ///< verbosity level [0 - 5] (default = 0)
   flott_uint alphabet_size; ///< actual unique symbols found in input.
+  size_t thread_count;      ///< worker threads (default = 0, serial)
+  flott_cache *cache;       ///< result cache (see 'flott_t_transform_cached')
+  const flott_allocator
+    *allocator;             ///< heap allocator (default = NULL, C library)
   void *user;               ///< pointer to custom user application data
   flott_private _private;   ///< private object data (do not touch please)
 };
 
+/**
+ * token workspace that is reserved once for the largest input and lent to
+ * objects one after another (see 'flott_use_workspace')
+ */
+struct flott_workspace
+{
+  void *data;               ///< workspace memory
+  size_t size;              ///< capacity in bytes
+  flott_backing backing;    ///< memory backing of 'data'
+  const flott_allocator
+    *allocator;             ///< allocator of 'data' (NULL = huge pages/heap)
+};
+
 flott_object *flott_create_instance (size_t input_source_count);
+flott_object *flott_create_instance_with (size_t input_source_count,
+                                          const flott_allocator *allocator);
+int flott_workspace_reserve (flott_workspace *workspace, size_t input_length,
+                             flott_symbol_type symbol_type);
+void flott_workspace_release (flott_workspace *workspace);
+int flott_use_workspace (flott_object *op, const flott_workspace *workspace);
+int flott_set_workspace (flott_object *op, void *workspace, size_t size);
+void *flott_reserve_workspace (flott_object *op, size_t size);
+size_t flott_get_workspace_size (size_t input_length,
+                                 flott_symbol_type symbol_type);
+int flott_load_streams (flott_object *op);
 int flott_initialize (flott_object *op);
+flott_backing flott_get_workspace_backing (const flott_object *op);
+int flott_get_observer_policy (const flott_object *op);
+void flott_t_transform_policy (flott_object *op, int policy);
 void flott_t_transform_callback (flott_object *op);
 void flott_t_transform (flott_object *op);
 void flott_inverse_t_transform (flott_object *op);
 void flott_input_write (flott_object *op, size_t cp_start_offset,
                         size_t cp_length, FILE *output_handle);
+void flott_prefetch_input (flott_object *op, size_t index);
 void flott_deinitialize (flott_object *op);
 void flott_destroy (flott_object *op);
 int flott_set_status (flott_object *op, int code, const int level, ...);
@@ -249,6 +501,24 @@ int flott_set_status (flott_object *op, int code, const int level, ...);
 /* provide normalized t-information distance prototypes */
 #include "flott_nid.h"
 
+/* provide short string (16-bit engine) batch prototypes */
+#include "flott_short.h"
+
+/* provide sliding window prototypes */
+#include "flott_window.h"
+
+/* provide multi-threaded batch prototypes */
+#include "flott_batch.h"
+
+/* provide all-pairs distance matrix prototypes */
+#include "flott_matrix.h"
+
+/* provide persistent result cache prototypes */
+#include "flott_cache.h"
+
+/* provide suffix t-complexity profile prototypes */
+#include "flott_profile.h"
+
 #ifdef __cplusplus
 }
 #endif
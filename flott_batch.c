@@ -0,0 +1,248 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flott.h"
+#include "flott_batch.h"
+#include "flott_thread.h"
+#include "flott_util.h"
+
+typedef struct flott_batch_item flott_batch_item;
+typedef struct flott_batch_queue flott_batch_queue;
+typedef struct flott_batch_worker flott_batch_worker;
+
+struct flott_batch_item
+{
+  size_t length;            ///< input source length
+  size_t index;             ///< input source index
+};
+
+struct flott_batch_queue
+{
+  flott_mutex mutex;        ///< guards 'next', 'ret_val' and 'op->status'
+  flott_batch_item *item;   ///< input sources, longest first
+  size_t count;             ///< number of input sources
+  size_t next;              ///< next item to be processed
+  int ret_val;              ///< status of the first failing input
+  flott_object *op;         ///< caller's flott object
+  flott_result *result;     ///< results in input order
+};
+
+struct flott_batch_worker
+{
+  flott_object object;      ///< worker object, owns a reusable workspace
+  flott_source source;      ///< copy of the input source being processed
+  size_t member;            ///< single member input sequence
+  flott_batch_queue *queue;
+  flott_thread thread;
+  bool started;
+};
+
+static int
+flott_batch_compare (const void *a, const void *b)
+{
+  const flott_batch_item *item_a = (const flott_batch_item *) a;
+  const flott_batch_item *item_b = (const flott_batch_item *) b;
+
+  /* longest first, ties in input order */
+  if (item_a->length != item_b->length)
+    {
+      return (item_a->length < item_b->length) ? 1 : -1;
+    }
+  return (item_a->index < item_b->index) ? -1 : (item_a->index > item_b->index);
+}
+
+static void *
+flott_batch_work (void *argument)
+{
+  flott_batch_worker *worker = (flott_batch_worker *) argument;
+  flott_batch_queue *queue = worker->queue;
+  flott_source *source;
+  char *bytes;
+  size_t index;
+  int ret_val;
+
+  while (true)
+    {
+      /* fetch next input source */
+      flott_mutex_lock (&(queue->mutex));
+      if (queue->next == queue->count || queue->ret_val != FLOTT_SUCCESS)
+        {
+          flott_mutex_unlock (&(queue->mutex));
+          break;
+        }
+      index = queue->item[queue->next++].index;
+      flott_mutex_unlock (&(queue->mutex));
+
+      /* work on a private copy of the source (file handles, loaded data) */
+      source = &(queue->op->input.source[index]);
+      worker->source = *source;
+      bytes = source->data.bytes;
+
+      ret_val = flott_t_transform_cached (&(worker->object),
+                                          FLOTT_OBSERVE_NONE);
+      if (ret_val == FLOTT_SUCCESS)
+        {
+          queue->result[index] = worker->object.result;
+        }
+
+      /* release data the engine loaded/mapped for this input */
+      if (worker->source.data.bytes != bytes)
+        {
+          if (worker->source.storage_type == FLOTT_DEV_FILE_TO_MEM)
+            {
+              flott_deallocate (worker->object.allocator,
+                                worker->source.data.bytes);
+            }
+          else if (worker->source.storage_type == FLOTT_DEV_MMAP)
+            {
+              flott_unmap_file (worker->source.data.bytes,
+                                worker->source.length);
+            }
+        }
+      worker->source.data.bytes = NULL; ///< never release data owned by 'op'
+
+      if (ret_val != FLOTT_SUCCESS)
+        {
+          flott_mutex_lock (&(queue->mutex));
+          if (queue->ret_val == FLOTT_SUCCESS)
+            {
+              queue->ret_val = ret_val;
+              queue->op->status = worker->object.status;
+            }
+          flott_mutex_unlock (&(queue->mutex));
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * t-transform each input source of 'op' independently, writing the result of
+ * 'op->input.source[i]' to 'result[i]'.
+ *
+ * Sources are handed out longest first to 'thread_count' workers (0: one per
+ * core); each worker owns a flott object whose workspace is reused for all of
+ * its inputs. Symbol type, terminal character, verbosity, error/message
+ * handlers and the result cache are taken from 'op'. On error the status of
+ * the first failing input is copied to 'op' and remaining inputs are skipped.
+ */
+int
+flott_batch (flott_object *op, size_t thread_count, flott_result *result)
+{
+  flott_batch_queue queue;
+  flott_batch_worker *worker;
+  flott_object *object;
+  size_t i;
+  int ret_val;
+
+  if (op == NULL || result == NULL
+      || (op->input.source == NULL && op->input.count > 0))
+    {
+      return FLOTT_ERR_INVALID_OBJ;
+    }
+  if (op->input.count == 0)
+    {
+      return FLOTT_SUCCESS;
+    }
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+
+  if (thread_count == 0)
+    {
+      thread_count = flott_get_cpu_count ();
+    }
+  thread_count = flott_min_M (thread_count, FLOTT_MAX_THREADS);
+  thread_count = flott_min_M (thread_count, op->input.count);
+
+  memset (&queue, 0, sizeof (flott_batch_queue));
+  queue.item = flott_allocate (op->allocator,
+                               op->input.count * sizeof (flott_batch_item));
+  worker = flott_allocate (op->allocator,
+                           thread_count * sizeof (flott_batch_worker));
+  if (queue.item == NULL || worker == NULL || flott_mutex_init (&queue.mutex))
+    {
+      flott_deallocate (op->allocator, queue.item);
+      flott_deallocate (op->allocator, worker);
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (batch workers)");
+    }
+
+  memset (worker, 0, thread_count * sizeof (flott_batch_worker));
+
+  /* schedule longest inputs first to keep all workers busy until the end */
+  for (i = 0; i < op->input.count; i++)
+    {
+      queue.item[i].length = op->input.source[i].length;
+      queue.item[i].index = i;
+    }
+  qsort (queue.item, op->input.count, sizeof (flott_batch_item),
+         flott_batch_compare);
+
+  queue.count = op->input.count;
+  queue.ret_val = FLOTT_SUCCESS;
+  queue.op = op;
+  queue.result = result;
+
+  /* set up single source worker objects */
+  for (i = 0; i < thread_count; i++)
+    {
+      object = &(worker[i].object);
+      object->input.symbol_type = op->input.symbol_type;
+      object->input.append_termchar = op->input.append_termchar;
+      object->verbosity_level = op->verbosity_level;
+      object->handler.error = op->handler.error;
+      object->handler.message = op->handler.message;
+      object->user = op->user;
+      object->cache = op->cache;
+      object->allocator = op->allocator;
+      object->scratch = op->scratch;
+      object->input.count = 1;
+      object->input.source = &(worker[i].source);
+      object->input.sequence.length = 1;
+      object->input.sequence.member = &(worker[i].member);
+      worker[i].queue = &queue;
+    }
+
+  /* the calling thread acts as the first worker */
+  for (i = 1; i < thread_count; i++)
+    {
+      worker[i].started = (flott_thread_create (&(worker[i].thread),
+                                                flott_batch_work,
+                                                &worker[i]) == 0);
+    }
+  flott_batch_work (&worker[0]);
+
+  for (i = 0; i < thread_count; i++)
+    {
+      if (worker[i].started == true)
+        {
+          flott_thread_join (&(worker[i].thread));
+        }
+      flott_deinitialize (&(worker[i].object));
+    }
+
+  flott_mutex_destroy (&queue.mutex);
+  flott_deallocate (op->allocator, queue.item);
+  flott_deallocate (op->allocator, worker);
+
+  return queue.ret_val;
+}
@@ -0,0 +1,855 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "flott.h"
+#include "flott_cache.h"
+#include "flott_thread.h"
+
+#define FLOTT_CACHE_NONE    0  ///< empty index slot / end of LRU list
+
+#define flott_cache_rotl_M(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+typedef struct flott_cache_hasher flott_cache_hasher;
+typedef struct flott_cache_record flott_cache_record;
+typedef struct flott_cache_entry flott_cache_entry;
+
+/**
+ * SipHash-2-4 state with 128-bit output, keyed by the cache file's secret
+ */
+struct flott_cache_hasher
+{
+  flott_uint64 v[4];
+  flott_uint64 tail;        ///< bytes of an incomplete word, little-endian
+  flott_uint64 length;      ///< number of bytes hashed
+};
+
+/**
+ * cache file record (host byte order)
+ */
+struct flott_cache_record
+{
+  flott_cache_key key;
+  flott_uint64 levels;
+  flott_uint64 tl_length;
+  double t_complexity;
+  double t_information;
+  double t_entropy;
+  flott_uint64 cf_histogram[FLOTT_CF_HISTOGRAM_SIZE];
+};
+
+struct flott_cache_entry
+{
+  flott_cache_record record;
+  size_t newer;             ///< LRU list links (entry index + 1)
+  size_t older;
+};
+
+struct flott_cache
+{
+  flott_mutex mutex;        ///< guards everything below
+  const flott_allocator *allocator; ///< heap allocations (NULL: libc)
+  char *path;               ///< cache file
+  char *lock_path;          ///< advisory lock file ('path'.lock)
+  char *temp_path;          ///< file written by 'flott_cache_close' ('path'.tmp)
+  size_t capacity;          ///< maximum number of entries
+  size_t count;             ///< number of entries in use
+  size_t newest;            ///< most recently used entry (index + 1)
+  size_t oldest;            ///< least recently used entry (index + 1)
+  size_t mask;              ///< index size - 1 (power of two)
+  size_t *slot;             ///< open addressing index (entry index + 1)
+  flott_cache_entry *entry;
+  flott_uint64 secret[2];   ///< SipHash key of the cache file
+  bool dirty;               ///< entries or their order changed since loading
+};
+
+static void
+flott_cache_round (flott_uint64 *v)
+{
+  v[0] += v[1];
+  v[1] = flott_cache_rotl_M (v[1], 13) ^ v[0];
+  v[0] = flott_cache_rotl_M (v[0], 32);
+  v[2] += v[3];
+  v[3] = flott_cache_rotl_M (v[3], 16) ^ v[2];
+  v[0] += v[3];
+  v[3] = flott_cache_rotl_M (v[3], 21) ^ v[0];
+  v[2] += v[1];
+  v[1] = flott_cache_rotl_M (v[1], 17) ^ v[2];
+  v[2] = flott_cache_rotl_M (v[2], 32);
+}
+
+static void
+flott_cache_compress (flott_cache_hasher *hasher, flott_uint64 word)
+{
+  hasher->v[3] ^= word;
+  flott_cache_round (hasher->v);
+  flott_cache_round (hasher->v);
+  hasher->v[0] ^= word;
+}
+
+static void
+flott_cache_hash_begin (flott_cache_hasher *hasher, const flott_uint64 *secret)
+{
+  hasher->v[0] = 0x736f6d6570736575ULL ^ secret[0];
+  hasher->v[1] = 0x646f72616e646f6dULL ^ secret[1] ^ 0xee; ///< 128-bit output
+  hasher->v[2] = 0x6c7967656e657261ULL ^ secret[0];
+  hasher->v[3] = 0x7465646279746573ULL ^ secret[1];
+  hasher->tail = 0;
+  hasher->length = 0;
+}
+
+static void
+flott_cache_hash_byte (flott_cache_hasher *hasher, unsigned char byte)
+{
+  hasher->tail |= (flott_uint64) byte << ((hasher->length & 7) << 3);
+  if ((++(hasher->length) & 7) == 0)
+    {
+      flott_cache_compress (hasher, hasher->tail);
+      hasher->tail = 0;
+    }
+}
+
+/**
+ * hash 'length' bytes of 'data'; consecutive calls hash the concatenation
+ * of their data, whatever its chunking
+ */
+static void
+flott_cache_hash (flott_cache_hasher *hasher, const char *data, size_t length)
+{
+  const unsigned char *byte = (const unsigned char *) data;
+  size_t i = 0;
+
+  while (i < length && (hasher->length & 7) != 0)
+    {
+      flott_cache_hash_byte (hasher, byte[i++]);
+    }
+  for (; i + 8 <= length; i += 8) /* little-endian words */
+    {
+      flott_cache_compress (hasher, (flott_uint64) byte[i]
+                            | ((flott_uint64) byte[i + 1] << 8)
+                            | ((flott_uint64) byte[i + 2] << 16)
+                            | ((flott_uint64) byte[i + 3] << 24)
+                            | ((flott_uint64) byte[i + 4] << 32)
+                            | ((flott_uint64) byte[i + 5] << 40)
+                            | ((flott_uint64) byte[i + 6] << 48)
+                            | ((flott_uint64) byte[i + 7] << 56));
+    }
+  hasher->length += i & ~((size_t) 7);
+  while (i < length)
+    {
+      flott_cache_hash_byte (hasher, byte[i++]);
+    }
+}
+
+static void
+flott_cache_hash_word (flott_cache_hasher *hasher, flott_uint64 word)
+{
+  char byte[8];
+  int i;
+
+  for (i = 0; i < 8; i++)
+    {
+      byte[i] = (char) (word >> (i << 3));
+    }
+  flott_cache_hash (hasher, byte, 8);
+}
+
+static void
+flott_cache_hash_end (flott_cache_hasher *hasher, flott_uint64 *hash)
+{
+  flott_uint64 *v = hasher->v;
+  int i;
+
+  flott_cache_compress (hasher, hasher->tail | (hasher->length << 56));
+  v[2] ^= 0xee;
+  for (i = 0; i < 4; i++)
+    {
+      flott_cache_round (v);
+    }
+  hash[0] = v[0] ^ v[1] ^ v[2] ^ v[3];
+  v[1] ^= 0xdd;
+  for (i = 0; i < 4; i++)
+    {
+      flott_cache_round (v);
+    }
+  hash[1] = v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+static int
+flott_cache_hash_file (flott_cache_hasher *hasher, const char *path,
+                       size_t length, const flott_allocator *allocator)
+{
+  char *buffer;
+  size_t count;
+  FILE *handle;
+  int ret_val = FLOTT_SUCCESS;
+
+  if ((handle = fopen (path, "rb")) == NULL)
+    {
+      return FLOTT_ERR_LOADING_FILE;
+    }
+  if ((buffer = (char *) flott_allocate (allocator, FLOTT_CACHE_CHUNK)) == NULL)
+    {
+      fclose (handle);
+      return FLOTT_ERR_MALLOC_FLOTT;
+    }
+
+  while (length > 0 && ret_val == FLOTT_SUCCESS)
+    {
+      count = flott_min_M (length, FLOTT_CACHE_CHUNK);
+      if (fread (buffer, 1, count, handle) != count)
+        {
+          ret_val = FLOTT_ERR_LOADING_FILE;
+        }
+      flott_cache_hash (hasher, buffer, count);
+      length -= count;
+    }
+
+  flott_deallocate (allocator, buffer);
+  fclose (handle);
+  return ret_val;
+}
+
+static int
+flott_cache_hash_reader (flott_cache_hasher *hasher,
+                         const flott_source *source,
+                         const flott_allocator *allocator)
+{
+  const flott_reader *reader = source->data.reader;
+  char *buffer;
+  size_t count, offset = 0;
+  int ret_val = FLOTT_SUCCESS;
+
+  if (reader == NULL || reader->pread == NULL)
+    {
+      return FLOTT_ERR_LOADING_FILE; ///< a single pass reader can't be keyed
+    }
+  if ((buffer = (char *) flott_allocate (allocator, FLOTT_CACHE_CHUNK)) == NULL)
+    {
+      return FLOTT_ERR_MALLOC_FLOTT;
+    }
+
+  while (offset < source->length && ret_val == FLOTT_SUCCESS)
+    {
+      count = flott_min_M (source->length - offset, FLOTT_CACHE_CHUNK);
+      if (reader->pread (source->user, buffer, count, offset) != count)
+        {
+          ret_val = FLOTT_ERR_LOADING_FILE;
+        }
+      flott_cache_hash (hasher, buffer, count);
+      offset += count;
+    }
+
+  flott_deallocate (allocator, buffer);
+  return ret_val;
+}
+
+/**
+ * compute the key in 'cache' of the input sequence of 'op' (all sources if
+ * the sequence is empty); files are read but not loaded into memory. The
+ * content is hashed with SipHash-2-4 under the secret of the cache file, so
+ * keys of one input differ between cache files.
+ */
+int
+flott_cache_key_input (flott_cache *cache, flott_object *op,
+                       flott_cache_key *key)
+{
+  int ret_val = FLOTT_SUCCESS;
+  size_t length, i, index;
+  flott_source *source;
+  flott_cache_hasher hasher;
+
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+
+  length = (op->input.sequence.length > 0) ? op->input.sequence.length
+                                            : op->input.count;
+  flott_cache_hash_begin (&hasher, cache->secret);
+  key->length = 0;
+  key->params = (flott_uint64) op->input.symbol_type
+                | ((flott_uint64) op->input.append_termchar << 16);
+
+  for (i = 0; i < length && ret_val == FLOTT_SUCCESS; i++)
+    {
+      index = (op->input.sequence.length > 0) ? op->input.sequence.member[i]
+                                              : i;
+      if (index >= op->input.count)
+        {
+          return flott_set_status (op, FLOTT_ERR_INDEX_BOUNDS, FLOTT_VL_FATAL,
+                                   " (sequence index)");
+        }
+      source = &(op->input.source[index]);
+      flott_cache_hash_word (&hasher, (flott_uint64) source->length);
+      key->length += source->length;
+
+      switch (source->storage_type)
+        {
+          case FLOTT_DEV_MEM :
+          case FLOTT_DEV_DEALLOC_MEM :
+            if (source->data.bytes == NULL && source->length > 0)
+              {
+                return flott_set_status (op, FLOTT_ERR_NULL_POINTER,
+                                         FLOTT_VL_FATAL);
+              }
+            flott_cache_hash (&hasher, source->data.bytes, source->length);
+            break;
+          case FLOTT_DEV_MMAP :
+            if (source->data.bytes != NULL)
+              {
+                flott_cache_hash (&hasher, source->data.bytes,
+                                  source->length);
+                break;
+              }
+            /* no break, not mapped yet */
+          case FLOTT_DEV_FILE_TO_MEM :
+          case FLOTT_DEV_FILE :
+            ret_val = flott_cache_hash_file (&hasher, source->path,
+                                             source->length, op->allocator);
+            if (ret_val != FLOTT_SUCCESS)
+              {
+                ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                            FLOTT_VL_FATAL, source->path);
+              }
+            break;
+          case FLOTT_DEV_CALLBACK :
+            ret_val = flott_cache_hash_reader (&hasher, source,
+                                               op->allocator);
+            if (ret_val != FLOTT_SUCCESS)
+              {
+                ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                            FLOTT_VL_FATAL, "callback source");
+              }
+            break;
+          default : /* stop symbol */
+            flott_cache_hash_word (&hasher, ~((flott_uint64) 0));
+            break;
+        }
+    }
+
+  if (op->input.symbol_type == FLOTT_SYMBOL_BIT)
+    {
+      key->length <<= 3;
+    }
+  flott_cache_hash_end (&hasher, key->hash);
+
+  return ret_val;
+}
+
+static bool
+flott_cache_key_equal (const flott_cache_key *a, const flott_cache_key *b)
+{
+  return a->hash[0] == b->hash[0] && a->hash[1] == b->hash[1]
+         && a->length == b->length && a->params == b->params;
+}
+
+/**
+ * index position of 'key', or of the empty slot it would be inserted at
+ */
+static size_t
+flott_cache_find (const flott_cache *cache, const flott_cache_key *key)
+{
+  size_t position = (size_t) key->hash[0] & cache->mask;
+
+  while (cache->slot[position] != FLOTT_CACHE_NONE
+         && !flott_cache_key_equal (
+                &(cache->entry[cache->slot[position] - 1].record.key), key))
+    {
+      position = (position + 1) & cache->mask;
+    }
+
+  return position;
+}
+
+/**
+ * remove index slot 'position', shifting back entries of its probe run
+ */
+static void
+flott_cache_unindex (flott_cache *cache, size_t position)
+{
+  size_t next = position;
+  size_t home;
+
+  while (true)
+    {
+      next = (next + 1) & cache->mask;
+      if (cache->slot[next] == FLOTT_CACHE_NONE)
+        {
+          break;
+        }
+      home = (size_t) cache->entry[cache->slot[next] - 1].record.key.hash[0]
+             & cache->mask;
+
+      /* move the entry unless its home lies cyclically in (position, next] */
+      if (((next - home) & cache->mask) >= ((next - position) & cache->mask))
+        {
+          cache->slot[position] = cache->slot[next];
+          position = next;
+        }
+    }
+  cache->slot[position] = FLOTT_CACHE_NONE;
+}
+
+static void
+flott_cache_unlink (flott_cache *cache, size_t index)
+{
+  flott_cache_entry *entry = &(cache->entry[index - 1]);
+
+  if (entry->newer != FLOTT_CACHE_NONE)
+    cache->entry[entry->newer - 1].older = entry->older;
+  else
+    cache->newest = entry->older;
+
+  if (entry->older != FLOTT_CACHE_NONE)
+    cache->entry[entry->older - 1].newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+}
+
+static void
+flott_cache_link (flott_cache *cache, size_t index)
+{
+  flott_cache_entry *entry = &(cache->entry[index - 1]);
+
+  entry->newer = FLOTT_CACHE_NONE;
+  entry->older = cache->newest;
+  if (cache->newest != FLOTT_CACHE_NONE)
+    cache->entry[cache->newest - 1].newer = index;
+  else
+    cache->oldest = index;
+  cache->newest = index;
+}
+
+/* caller holds the mutex, the cache is not full and 'record' not cached */
+static void
+flott_cache_append (flott_cache *cache, const flott_cache_record *record)
+{
+  size_t index = ++(cache->count);
+  flott_cache_entry *entry = &(cache->entry[index - 1]);
+
+  cache->slot[flott_cache_find (cache, &(record->key))] = index;
+  entry->record = *record;
+  entry->older = FLOTT_CACHE_NONE;
+  entry->newer = cache->oldest;
+  if (cache->oldest != FLOTT_CACHE_NONE)
+    cache->entry[cache->oldest - 1].older = index;
+  else
+    cache->newest = index;
+  cache->oldest = index;
+}
+
+/* caller holds the mutex */
+static void
+flott_cache_insert (flott_cache *cache, const flott_cache_record *record)
+{
+  size_t position = flott_cache_find (cache, &(record->key));
+  size_t index = cache->slot[position];
+
+  if (index != FLOTT_CACHE_NONE) /* update */
+    {
+      flott_cache_unlink (cache, index);
+    }
+  else
+    {
+      if (cache->count < cache->capacity)
+        {
+          index = ++(cache->count);
+        }
+      else /* evict the least recently used entry */
+        {
+          index = cache->oldest;
+          flott_cache_unlink (cache, index);
+          flott_cache_unindex (cache, flott_cache_find (cache,
+                                     &(cache->entry[index - 1].record.key)));
+          position = flott_cache_find (cache, &(record->key));
+        }
+      cache->slot[position] = index;
+    }
+
+  cache->entry[index - 1].record = *record;
+  flott_cache_link (cache, index);
+}
+
+/**
+ * read cache file 'path': its secret into 'secret', its records (most
+ * recently used first, at most the cache capacity) into 'record', allocated
+ * with the cache's allocator, and their number into 'count'. Returns false
+ * if the file is missing, unreadable or of another version.
+ */
+static bool
+flott_cache_read (flott_cache *cache, const char *path, flott_uint64 *secret,
+                  flott_cache_record **record, size_t *count)
+{
+  char magic[8];
+  flott_uint version = 0, record_size = 0;
+  flott_uint64 length = 0;
+  FILE *handle;
+  bool valid;
+
+  *record = NULL;
+  *count = 0;
+  if ((handle = fopen (path, "rb")) == NULL)
+    {
+      return false;
+    }
+  valid = (fread (magic, 1, 8, handle) == 8
+           && memcmp (magic, FLOTT_CACHE_MAGIC, 8) == 0
+           && fread (&version, sizeof (flott_uint), 1, handle) == 1
+           && version == FLOTT_CACHE_VERSION
+           && fread (&record_size, sizeof (flott_uint), 1, handle) == 1
+           && record_size == sizeof (flott_cache_record)
+           && fread (secret, sizeof (flott_uint64), 2, handle) == 2
+           && fread (&length, sizeof (flott_uint64), 1, handle) == 1);
+  if (valid && (length = flott_min_M (length, cache->capacity)) > 0)
+    {
+      *record = (flott_cache_record *) flott_allocate (cache->allocator,
+                                        (size_t) length
+                                        * sizeof (flott_cache_record));
+      if (*record != NULL)
+        {
+          *count = fread (*record, sizeof (flott_cache_record),
+                          (size_t) length, handle);
+        }
+    }
+  fclose (handle);
+
+  return valid;
+}
+
+/**
+ * write the cache to 'path'.tmp, which then replaces 'path'; the caller
+ * holds the exclusive lock on 'path'.lock
+ */
+static int
+flott_cache_write (flott_cache *cache)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_uint version = FLOTT_CACHE_VERSION;
+  flott_uint record_size = sizeof (flott_cache_record);
+  flott_uint64 count = (flott_uint64) cache->count;
+  size_t index;
+  FILE *handle;
+
+  handle = fopen (cache->temp_path, "wb");
+  if (handle == NULL
+      || fwrite (FLOTT_CACHE_MAGIC, 1, 8, handle) != 8
+      || fwrite (&version, sizeof (flott_uint), 1, handle) != 1
+      || fwrite (&record_size, sizeof (flott_uint), 1, handle) != 1
+      || fwrite (cache->secret, sizeof (flott_uint64), 2, handle) != 2
+      || fwrite (&count, sizeof (flott_uint64), 1, handle) != 1)
+    {
+      ret_val = FLOTT_ERR_WRITING_FILE;
+    }
+  for (index = cache->newest; index != FLOTT_CACHE_NONE
+       && ret_val == FLOTT_SUCCESS; index = cache->entry[index - 1].older)
+    {
+      if (fwrite (&(cache->entry[index - 1].record),
+                  sizeof (flott_cache_record), 1, handle) != 1)
+        {
+          ret_val = FLOTT_ERR_WRITING_FILE;
+        }
+    }
+  if (handle != NULL && fclose (handle) != 0)
+    {
+      ret_val = FLOTT_ERR_WRITING_FILE;
+    }
+  if (ret_val == FLOTT_SUCCESS
+      && flott_replace_file (cache->temp_path, cache->path) != 0)
+    {
+      ret_val = FLOTT_ERR_WRITING_FILE;
+    }
+  if (ret_val != FLOTT_SUCCESS && handle != NULL)
+    {
+      remove (cache->temp_path); ///< the old cache file stays intact
+    }
+
+  return ret_val;
+}
+
+/**
+ * open the result cache stored in file 'path' holding up to 'capacity'
+ * results (0: FLOTT_CACHE_CAPACITY); memory comes from 'allocator' (NULL:
+ * libc). A missing or unreadable cache file is replaced by an empty one
+ * with a new random secret, the key of its content hashes; the file is
+ * rewritten by 'flott_cache_close'. The file is read under a shared advisory
+ * lock on 'path'.lock, so that a concurrent close is not seen half done.
+ */
+int
+flott_cache_open (const char *path, size_t capacity,
+                  const flott_allocator *allocator, flott_cache **cache)
+{
+  flott_cache *cp;
+  flott_cache_record *record;
+  size_t i, count, size = 2;
+  size_t length;
+  FILE *lock;
+  bool valid;
+
+  *cache = NULL;
+  if (path == NULL)
+    {
+      return FLOTT_ERR_NULL_POINTER;
+    }
+  if (capacity == 0)
+    {
+      capacity = FLOTT_CACHE_CAPACITY;
+    }
+  while (size < (capacity << 1))
+    {
+      size <<= 1; ///< keep the index at most half full
+    }
+
+  cp = (flott_cache *) flott_allocate (allocator, sizeof (flott_cache));
+  if (cp == NULL)
+    {
+      return FLOTT_ERR_MALLOC_FLOTT;
+    }
+  memset (cp, 0, sizeof (flott_cache));
+  cp->allocator = allocator;
+  cp->capacity = capacity;
+  cp->mask = size - 1;
+  length = strlen (path) + sizeof (".lock");
+  cp->path = (char *) flott_allocate (allocator, 3 * length);
+  cp->slot = (size_t *) flott_allocate (allocator, size * sizeof (size_t));
+  cp->entry = (flott_cache_entry *) flott_allocate (allocator, capacity
+                                          * sizeof (flott_cache_entry));
+  if (cp->path == NULL || cp->slot == NULL || cp->entry == NULL
+      || flott_mutex_init (&(cp->mutex)))
+    {
+      flott_deallocate (allocator, cp->path);
+      flott_deallocate (allocator, cp->slot);
+      flott_deallocate (allocator, cp->entry);
+      flott_deallocate (allocator, cp);
+      return FLOTT_ERR_MALLOC_FLOTT;
+    }
+  memset (cp->slot, 0, size * sizeof (size_t));
+  cp->lock_path = cp->path + length;
+  cp->temp_path = cp->lock_path + length;
+  sprintf (cp->path, "%s", path);
+  sprintf (cp->lock_path, "%s.lock", path);
+  sprintf (cp->temp_path, "%s.tmp", path);
+
+  /* load records, most recently used first */
+  lock = flott_lock_file (cp->lock_path, false);
+  valid = flott_cache_read (cp, cp->path, cp->secret, &record, &count);
+  flott_unlock_file (lock);
+  if (valid == false)
+    {
+      /* the secret of a new file is drawn once, under the exclusive lock,
+         so that caches opened on it concurrently key inputs alike */
+      lock = flott_lock_file (cp->lock_path, true);
+      valid = flott_cache_read (cp, cp->path, cp->secret, &record, &count);
+      if (valid == false)
+        {
+          if (flott_random_bytes (cp->secret, sizeof (cp->secret)) != 0)
+            {
+              cp->secret[0] = (flott_uint64) time (NULL);
+              cp->secret[1] = (flott_uint64) (size_t) cp;
+            }
+          flott_cache_write (cp);
+        }
+      flott_unlock_file (lock);
+    }
+  for (i = count; i > 0; i--)
+    {
+      flott_cache_insert (cp, &record[i - 1]);
+    }
+  flott_deallocate (allocator, record);
+
+  *cache = cp;
+  return FLOTT_SUCCESS;
+}
+
+/**
+ * write the cache back to its file (if anything changed) and release it.
+ *
+ * Under an exclusive advisory lock on 'path'.lock, results another process
+ * stored since this cache was opened are merged in (as least recently used,
+ * while there is room), and the cache is written to 'path'.tmp, which then
+ * replaces 'path'. Readers thus never see a partial file, and concurrent
+ * processes sharing a cache file don't drop each other's results.
+ */
+int
+flott_cache_close (flott_cache *cache)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_cache_record *record;
+  const flott_allocator *allocator;
+  flott_uint64 secret[2];
+  size_t count, i;
+  FILE *lock;
+
+  if (cache == NULL)
+    {
+      return FLOTT_SUCCESS;
+    }
+
+  if (cache->dirty == true)
+    {
+      lock = flott_lock_file (cache->lock_path, true);
+
+      /* merge results stored by others meanwhile, unless the file was
+         replaced by one with another secret */
+      if (flott_cache_read (cache, cache->path, secret, &record, &count)
+          && secret[0] == cache->secret[0] && secret[1] == cache->secret[1])
+        {
+          for (i = 0; i < count && cache->count < cache->capacity; i++)
+            {
+              if (cache->slot[flott_cache_find (cache, &(record[i].key))]
+                  == FLOTT_CACHE_NONE)
+                {
+                  flott_cache_append (cache, &record[i]);
+                }
+            }
+        }
+      flott_deallocate (cache->allocator, record);
+      ret_val = flott_cache_write (cache);
+
+      flott_unlock_file (lock);
+    }
+
+  allocator = cache->allocator;
+  flott_mutex_destroy (&(cache->mutex));
+  flott_deallocate (allocator, cache->path);
+  flott_deallocate (allocator, cache->slot);
+  flott_deallocate (allocator, cache->entry);
+  flott_deallocate (allocator, cache);
+
+  return ret_val;
+}
+
+/**
+ * look up the result cached for 'key'; a hit marks the entry most recently
+ * used. Safe to call from multiple threads.
+ */
+bool
+flott_cache_lookup (flott_cache *cache, const flott_cache_key *key,
+                    flott_result *result)
+{
+  flott_cache_record *record;
+  size_t index, bucket;
+
+  flott_mutex_lock (&(cache->mutex));
+  index = cache->slot[flott_cache_find (cache, key)];
+  if (index != FLOTT_CACHE_NONE)
+    {
+      record = &(cache->entry[index - 1].record);
+      result->levels = (size_t) record->levels;
+      result->tl_length = (size_t) record->tl_length;
+      result->t_complexity = record->t_complexity;
+      result->t_information = record->t_information;
+      result->t_entropy = record->t_entropy;
+      for (bucket = 0; bucket < FLOTT_CF_HISTOGRAM_SIZE; bucket++)
+        {
+          result->cf_histogram[bucket] = (size_t) record->cf_histogram[bucket];
+        }
+
+      if (cache->newest != index)
+        {
+          flott_cache_unlink (cache, index);
+          flott_cache_link (cache, index);
+          cache->dirty = true;
+        }
+    }
+  flott_mutex_unlock (&(cache->mutex));
+
+  return (index != FLOTT_CACHE_NONE);
+}
+
+/**
+ * cache 'result' under 'key', evicting the least recently used result if
+ * the cache is full. Safe to call from multiple threads.
+ */
+void
+flott_cache_store (flott_cache *cache, const flott_cache_key *key,
+                   const flott_result *result)
+{
+  flott_cache_record record;
+  size_t bucket;
+
+  record.key = *key;
+  record.levels = (flott_uint64) result->levels;
+  record.tl_length = (flott_uint64) result->tl_length;
+  record.t_complexity = result->t_complexity;
+  record.t_information = result->t_information;
+  record.t_entropy = result->t_entropy;
+  for (bucket = 0; bucket < FLOTT_CF_HISTOGRAM_SIZE; bucket++)
+    {
+      record.cf_histogram[bucket] = (flott_uint64) result->cf_histogram[bucket];
+    }
+
+  flott_mutex_lock (&(cache->mutex));
+  flott_cache_insert (cache, &record);
+  cache->dirty = true;
+  flott_mutex_unlock (&(cache->mutex));
+}
+
+/**
+ * initialize and t-transform 'op' with observer 'policy', unless 'op->cache'
+ * holds the result for the content of the input sequence: then only
+ * 'op->result' and 'op->input.length' are set and 'op->handler.init' is
+ * called, as if the input had been initialized. Observers other than the
+ * progress handler need the actual transform, so the cache is bypassed for
+ * such policies.
+ */
+int
+flott_t_transform_cached (flott_object *op, int policy)
+{
+  int ret_val;
+  flott_cache_key key;
+  flott_cache *cache = op->cache;
+
+  if (policy & ~FLOTT_OBSERVE_PROGRESS)
+    {
+      cache = NULL;
+    }
+
+  if (cache != NULL)
+    {
+      if ((ret_val = flott_cache_key_input (cache, op, &key))
+          != FLOTT_SUCCESS)
+        {
+          return ret_val;
+        }
+      if (flott_cache_lookup (cache, &key, &(op->result)) == true)
+        {
+          op->_private.ln2 = log (2.0);
+          op->input.length = (size_t) key.length;
+          if (op->handler.init != NULL)
+            {
+              ret_val = op->handler.init (op);
+            }
+          return ret_val;
+        }
+    }
+
+  if ((ret_val = flott_initialize (op)) == FLOTT_SUCCESS)
+    {
+      flott_t_transform_policy (op, policy);
+      if (cache != NULL)
+        {
+          flott_cache_store (cache, &key, &(op->result));
+        }
+    }
+
+  return ret_val;
+}
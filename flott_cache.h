@@ -0,0 +1,58 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef _FLOTT_CACHE_H_
+#define _FLOTT_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLOTT_CACHE_MAGIC     "FLOTTCHE" ///< cache file signature
+#define FLOTT_CACHE_VERSION   4          ///< cache file version
+#define FLOTT_CACHE_CAPACITY  4096       ///< default number of cached results
+#define FLOTT_CACHE_CHUNK     (1 << 16)  ///< file hashing buffer size
+
+typedef struct flott_cache_key flott_cache_key;
+
+/**
+ * identifies the t-transform result of an input sequence by content
+ */
+struct flott_cache_key
+{
+  flott_uint64 hash[2];  ///< SipHash-2-4 (128-bit) of the input sequence
+  flott_uint64 length;   ///< input length in symbols
+  flott_uint64 params;   ///< symbol type, terminal character
+};
+
+int flott_cache_open (const char *path, size_t capacity,
+                      const flott_allocator *allocator, flott_cache **cache);
+int flott_cache_close (flott_cache *cache);
+int flott_cache_key_input (flott_cache *cache, flott_object *op,
+                           flott_cache_key *key);
+bool flott_cache_lookup (flott_cache *cache, const flott_cache_key *key,
+                         flott_result *result);
+void flott_cache_store (flott_cache *cache, const flott_cache_key *key,
+                        const flott_result *result);
+int flott_t_transform_cached (flott_object *op, int policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLOTT_CACHE_H_ */
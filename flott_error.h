@@ -23,7 +23,7 @@
 extern "C" {
 #endif
 
-#define FLOTT_MAX_ERROR_CODES   21
+#define FLOTT_MAX_ERROR_CODES   24
 
 typedef enum flott_error_codes flott_error_codes;
 
@@ -46,7 +46,10 @@ enum flott_error_codes
   FLOTT_ERR_LOADING_FILE      = -17,
   FLOTT_ERR_FILE_NOT_FOUND    = -18,
   FLOTT_ERR_NULL_POINTER      = -19,
-  FLOTT_ERR_NID_NUM_INPUTS    = -20
+  FLOTT_ERR_NID_NUM_INPUTS    = -20,
+  FLOTT_ERR_WINDOW            = -21,
+  FLOTT_ERR_WRITING_FILE      = -22,
+  FLOTT_ERR_SCRATCH           = -23
 };
 
 #ifdef __cplusplus
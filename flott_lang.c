@@ -16,6 +16,7 @@
  *
  */
 
+#include "flott_platform.h"
 #include "flott_lang.h"
 #include "flott_error.h"
 
@@ -31,11 +32,13 @@ const char* flott_msg_help_G =
   "   -h              help (this screen)\n"
   "   -d              output normalized T-information distance\n"
   "   -D              output normalized T-complexity distance\n"
+  "   -a              output -d/-D distance matrix of all input pairs\n"
   "   -c              output T-complexity\n"
   "   -i              output T-information\n"
   "   -e              output average T-entropy rate\n"
   "   -r              output instantaneous T-entropy rate\n"
-  "   -x              output interpolated rates over entire input\n"
+  "   -x[=size]       output interpolated rates over entire input, or one row\n"
+  "                   per 'size' input symbols with min/mean/max rates (not -F=bin)\n"
   "   -n              output T-transform level\n"
   "   -k              output copy factor (a.k.a. T-expansion parameter)\n"
   "   -p              output copy pattern string\n"
@@ -45,14 +48,27 @@ const char* flott_msg_help_G =
   "   -u=[units]      output units: [bits, nats]; (default: bits)\n"
   "\nINPUT:\n"
   "   -I filename     set input filename (multiple allowed)\n"
+  "                   ('-', pipes and fifos are read until end of stream)\n"
   "   -S \"string\"     set input string (multiple allowed, enclose in quotes)\n"
   "   -b[bits]        set input symbol width in bits: [1, 8]; (default: 8)\n"
   "   -j              concatenate input files/strings (order: left-to-right)\n"
+  "   -w[size]        sliding window t-entropy, window size in bytes\n"
+  "   -s[stride]      sliding window stride in bytes; (default: window size)\n"
   "   -z              append terminal (dummy) character to input\n"
   "   -m              buffer input in memory\n"
+  "   -M              memory map input files (zero-copy)\n"
+  "   -T[threads]     number of worker threads: [1, 64]; (default: all cores)\n"
+  "                   (level-zero init, independent inputs without -j)\n"
+  "   -W dirname      out-of-core: keep token workspaces larger than half of the\n"
+  "                   physical memory in a temporary file in directory dirname\n"
   "\nOUTPUT:\n"
   "   -O filename     set output filename\n"
-  "   -F=[format]     output format options: [pretty, csv, tab]; (default: pretty)\n"
+  "   -C filename     cache results in file, keyed by input content (LRU)\n"
+  "   -P filename     write suffix t-complexity profile of (concatenated) input\n"
+  "                   to file, as raw (offset, t-complexity) pairs (no step output)\n"
+  "   -F=[format]     output format options: [pretty, csv, tab, bin];\n"
+  "                   (default: pretty; bin: little-endian records, no -p)\n"
+  "                   (-a: [phylip, csv, tab, bin]; (default: phylip))\n"
   "   -L              output column labels\n"
   "   -g              floating point precision: [0 - 100] (default: 2)\n"
   "   -q              quiet, omit status information (equivalent to -v0)\n"
@@ -83,7 +99,10 @@ const char* flott_errmsg_lut_G[FLOTT_MAX_ERROR_CODES] =
   "loading of file failed (%s).",
   "file not found (%s).",
   "invalid pointer found.",
-  "normalized information distance requires two inputs."
+  "normalized information distance requires two inputs.",
+  "invalid sliding window%s.",
+  "writing of output failed%s.",
+  "creation of scratch workspace failed (%s)."
 };
 
 /**
@@ -92,5 +111,21 @@ const char* flott_errmsg_lut_G[FLOTT_MAX_ERROR_CODES] =
 const char* flott_msg_lut_G[FLOTT_MAX_MESSAGE_CODES] =
 {
     "",
-    "option '%c' (%d) with '%s'"
+    "option '%c' (%d) with '%s'",
+    "token workspace of %" FLOTT_PRINTF_T_SIZE_T " bytes (%s)"
+};
+
+/**
+ * workspace memory backing names (indexed by 'flott_backing')
+ */
+const char* flott_backing_lut_G[] =
+{
+  "none",
+  "explicit huge pages",
+  "transparent huge pages",
+  "regular pages",
+  "aligned heap",
+  "borrowed",
+  "allocator",
+  "scratch file"
 };
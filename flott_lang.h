@@ -23,7 +23,7 @@
 extern "C" {
 #endif
 
-#define FLOTT_MAX_MESSAGE_CODES   2
+#define FLOTT_MAX_MESSAGE_CODES   3
 
 /**
  * flott message codes
@@ -31,13 +31,15 @@ extern "C" {
 enum flott_msg_codes
 {
   FLOTT_CUSTOM_MSG            =  0,
-  FLOTT_CMD_OPTION_PARAM      =  1
+  FLOTT_CMD_OPTION_PARAM      =  1,
+  FLOTT_MSG_WORKSPACE         =  2
 };
 
 /**
  * static global string resources (global variables indicated by '_G' suffix)
  */
 extern const char* flott_errmsg_lut_G[];
+extern const char* flott_backing_lut_G[];
 extern const char* flott_msg_lut_G[];
 extern const char* flott_msg_help_G;
 
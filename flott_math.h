@@ -74,7 +74,14 @@ flott_log2 (const size_t x)
 }
 #endif
 
+#define FLOTT_LI_INV_ERROR 5.0e-9 ///< max. relative error of tabulated li^-1
+#define FLOTT_T_INFORMATION_TOLERANCE 0.0 ///< default, refine table lookups
+
 double flott_get_t_information (double t_complexity);
+double flott_get_t_information_fast (double t_complexity, double tolerance);
+void flott_get_t_information_batch (const double *t_complexity,
+                                    double *t_information, size_t count,
+                                    double tolerance);
 
 #endif /* _FLOTT_MATH_H_ */
 
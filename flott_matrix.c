@@ -0,0 +1,496 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flott.h"
+#include "flott_matrix.h"
+#include "flott_thread.h"
+#include "flott_util.h"
+
+typedef struct flott_matrix_queue flott_matrix_queue;
+typedef struct flott_matrix_worker flott_matrix_worker;
+
+struct flott_matrix_queue
+{
+  flott_mutex mutex;        ///< guards 'next', 'ret_val' and 'op->status'
+  flott_matrix_type type;   ///< distance measure
+  size_t count;             ///< number of input sources (matrix rows)
+  size_t tiles;             ///< number of tiles per matrix row
+  size_t solo_jobs;         ///< single source transforms queued before tiles
+  size_t jobs;              ///< total number of jobs
+  size_t next;              ///< next job to be processed
+  int ret_val;              ///< status of the first failing job
+  flott_object *op;         ///< caller's flott object
+  flott_source *source;     ///< memory resident/streamed copies of all sources
+  double *solo;             ///< nti: I(x), ntc: C(x) of each source
+  double *pair;             ///< nti: I(x.y), ntc: C(x.stop.y)
+};
+
+struct flott_matrix_worker
+{
+  flott_object object;      ///< worker object, owns a reusable workspace
+  flott_source source[3];   ///< x, stop symbol, y
+  size_t member[3];         ///< input sequence
+  flott_matrix_queue *queue;
+  flott_thread thread;
+  bool started;
+};
+
+/**
+ * t-transform source 'x' alone (y == count) or concatenated with source 'y'
+ * and store the quantities the distance measure needs
+ */
+static int
+flott_matrix_transform (flott_matrix_worker *worker, size_t x, size_t y)
+{
+  int ret_val;
+  flott_matrix_queue *queue = worker->queue;
+  flott_object *object = &(worker->object);
+  size_t count = queue->count;
+  double *result;
+
+  worker->source[0] = queue->source[x];
+  object->input.append_termchar = true;
+  if (y == count) /* single source, always terminated */
+    {
+      object->input.sequence.length = 1;
+      result = &(queue->solo[x]);
+    }
+  else if (queue->type == FLOTT_MATRIX_NTI)
+    {
+      object->input.append_termchar = queue->op->input.append_termchar;
+      worker->source[1] = queue->source[y];
+      worker->member[1] = 1;
+      object->input.sequence.length = 2;
+      result = &(queue->pair[x * count + y]);
+    }
+  else /* ntc: x.stop.y */
+    {
+      worker->source[2] = queue->source[y];
+      worker->member[1] = 1;
+      worker->member[2] = 2;
+      object->input.sequence.length = 3;
+      result = &(queue->pair[x * count + y]);
+    }
+
+  ret_val = flott_t_transform_cached (object, FLOTT_OBSERVE_NONE);
+  *result = (queue->type == FLOTT_MATRIX_NTI) ? object->result.t_information
+                                              : object->result.t_complexity;
+
+  return ret_val;
+}
+
+static void *
+flott_matrix_work (void *argument)
+{
+  flott_matrix_worker *worker = (flott_matrix_worker *) argument;
+  flott_matrix_queue *queue = worker->queue;
+  size_t job, tile, x, y, x_end, y_end;
+  int ret_val = FLOTT_SUCCESS;
+
+  while (ret_val == FLOTT_SUCCESS)
+    {
+      /* fetch next job */
+      flott_mutex_lock (&(queue->mutex));
+      if (queue->next == queue->jobs || queue->ret_val != FLOTT_SUCCESS)
+        {
+          flott_mutex_unlock (&(queue->mutex));
+          break;
+        }
+      job = queue->next++;
+      flott_mutex_unlock (&(queue->mutex));
+
+      if (job < queue->solo_jobs)
+        {
+          ret_val = flott_matrix_transform (worker, job, queue->count);
+        }
+      else
+        {
+          /* a tile pairs FLOTT_MATRIX_TILE rows with as many columns */
+          tile = job - queue->solo_jobs;
+          x = (tile / queue->tiles) * FLOTT_MATRIX_TILE;
+          x_end = flott_min_M (x + FLOTT_MATRIX_TILE, queue->count);
+          y_end = flott_min_M ((tile % queue->tiles + 1) * FLOTT_MATRIX_TILE,
+                               queue->count);
+          for (; x < x_end && ret_val == FLOTT_SUCCESS; x++)
+            {
+              for (y = (tile % queue->tiles) * FLOTT_MATRIX_TILE;
+                   y < y_end && ret_val == FLOTT_SUCCESS; y++)
+                {
+                  ret_val = flott_matrix_transform (worker, x, y);
+                }
+            }
+        }
+
+      if (ret_val != FLOTT_SUCCESS)
+        {
+          flott_mutex_lock (&(queue->mutex));
+          if (queue->ret_val == FLOTT_SUCCESS)
+            {
+              queue->ret_val = ret_val;
+              queue->op->status = worker->object.status;
+            }
+          flott_mutex_unlock (&(queue->mutex));
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * load or map all memory resident input sources once, so that the
+ * transforms of all pairs share the same copy of the data
+ */
+static int
+flott_matrix_open_sources (flott_object *op, flott_source *source)
+{
+  int ret_val = FLOTT_SUCCESS;
+  size_t i;
+
+  for (i = 0; i < op->input.count && ret_val == FLOTT_SUCCESS; i++)
+    {
+      source[i] = op->input.source[i];
+      switch (source[i].storage_type)
+        {
+          case FLOTT_DEV_FILE_TO_MEM :
+            if (flott_load_file_to_memory (source[i].path,
+                                           &(source[i].data.bytes),
+                                           op->allocator)
+                != source[i].length)
+              {
+                source[i].data.bytes = NULL;
+                ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                            FLOTT_VL_FATAL, source[i].path);
+              }
+            break;
+          case FLOTT_DEV_MMAP :
+            if (source[i].data.bytes == NULL
+                && flott_map_file (source[i].path, source[i].length,
+                                   &(source[i].data.bytes)) != 0)
+              {
+                source[i].data.bytes = NULL;
+                ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                            FLOTT_VL_FATAL, source[i].path);
+              }
+            break;
+          default : break;
+        }
+    }
+
+  return ret_val;
+}
+
+static void
+flott_matrix_close_sources (flott_object *op, flott_source *source)
+{
+  size_t i;
+
+  for (i = 0; i < op->input.count; i++)
+    {
+      if (source[i].data.bytes == op->input.source[i].data.bytes)
+        {
+          continue; ///< owned by the caller
+        }
+      if (op->input.source[i].storage_type == FLOTT_DEV_FILE_TO_MEM)
+        {
+          flott_deallocate (op->allocator, source[i].data.bytes);
+        }
+      else if (op->input.source[i].storage_type == FLOTT_DEV_MMAP)
+        {
+          flott_unmap_file (source[i].data.bytes, source[i].length);
+        }
+    }
+}
+
+/**
+ * compute the 'count' x 'count' distance matrix of all input sources of 'op'
+ * (the input sequence is ignored), row-major in 'matrix': entry (i, j) is
+ * the distance 'flott_nti_dist'/'flott_ntc_dist' reports for a = i, b = j
+ * (ntc: up to the last bits, C(j) is summed in a different order).
+ *
+ * Both measures first transform every source once on its own (terminated)
+ * for I(i) or C(i), then one transform of i.j (nti) or i.stop.j (ntc) per
+ * entry. The parse of stop.j within i.stop.j is that of j alone, so C(i|j)
+ * is C(i.stop.j) - (C(j) + 1); the per-source results are shared by all
+ * entries of a row and column. Entries are computed in FLOTT_MATRIX_TILE
+ * square tiles by 'thread_count' workers (0: one per core), each reusing its
+ * workspace. Files that are buffered in memory or mapped are read once for
+ * the whole matrix. All transforms go through 'op->cache' if set, so the
+ * single source results also carry over between nti and ntc matrices.
+ */
+int
+flott_matrix (flott_object *op, flott_matrix_type type,
+              size_t thread_count, double *matrix)
+{
+  flott_matrix_queue queue;
+  flott_matrix_worker *worker;
+  flott_object *object;
+  size_t i, j, count;
+  double distance;
+  int ret_val;
+
+  if (op == NULL || matrix == NULL
+      || (op->input.source == NULL && op->input.count > 0))
+    {
+      return FLOTT_ERR_INVALID_OBJ;
+    }
+  if ((count = op->input.count) == 0)
+    {
+      return FLOTT_SUCCESS;
+    }
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+
+  memset (&queue, 0, sizeof (flott_matrix_queue));
+  queue.type = type;
+  queue.count = count;
+  queue.tiles = (count + FLOTT_MATRIX_TILE - 1) / FLOTT_MATRIX_TILE;
+  queue.solo_jobs = count;
+  queue.jobs = queue.solo_jobs + queue.tiles * queue.tiles;
+  queue.ret_val = FLOTT_SUCCESS;
+  queue.op = op;
+  queue.pair = matrix;
+
+  if (thread_count == 0)
+    {
+      thread_count = flott_get_cpu_count ();
+    }
+  thread_count = flott_min_M (thread_count, FLOTT_MAX_THREADS);
+  thread_count = flott_min_M (thread_count, queue.jobs);
+
+  queue.source = flott_allocate (op->allocator, count * sizeof (flott_source));
+  queue.solo = flott_allocate (op->allocator, count * sizeof (double));
+  worker = flott_allocate (op->allocator,
+                           thread_count * sizeof (flott_matrix_worker));
+  if (queue.source == NULL || worker == NULL || queue.solo == NULL
+      || flott_mutex_init (&queue.mutex))
+    {
+      flott_deallocate (op->allocator, queue.source);
+      flott_deallocate (op->allocator, queue.solo);
+      flott_deallocate (op->allocator, worker);
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (matrix workers)");
+    }
+  memset (queue.source, 0, count * sizeof (flott_source));
+  memset (worker, 0, thread_count * sizeof (flott_matrix_worker));
+
+  if ((queue.ret_val = flott_matrix_open_sources (op, queue.source))
+      == FLOTT_SUCCESS)
+    {
+      /* buffered and mapped files are memory resident from here on */
+      for (i = 0; i < count; i++)
+        {
+          if (queue.source[i].storage_type == FLOTT_DEV_FILE_TO_MEM
+              || queue.source[i].storage_type == FLOTT_DEV_MMAP)
+            {
+              queue.source[i].storage_type = FLOTT_DEV_MEM;
+            }
+        }
+
+      /* set up worker objects */
+      for (i = 0; i < thread_count; i++)
+        {
+          object = &(worker[i].object);
+          object->input.symbol_type = op->input.symbol_type;
+          object->verbosity_level = op->verbosity_level;
+          object->handler.error = op->handler.error;
+          object->handler.message = op->handler.message;
+          object->user = op->user;
+          object->cache = op->cache;
+          object->allocator = op->allocator;
+          object->scratch = op->scratch;
+          object->input.count = 3;
+          object->input.source = worker[i].source;
+          object->input.sequence.member = worker[i].member;
+          worker[i].source[1].storage_type = FLOTT_DEV_STOP_SYMBOL;
+          worker[i].source[1].length = 1;
+          worker[i].queue = &queue;
+        }
+
+      /* the calling thread acts as the first worker */
+      for (i = 1; i < thread_count; i++)
+        {
+          worker[i].started = (flott_thread_create (&(worker[i].thread),
+                                                    flott_matrix_work,
+                                                    &worker[i]) == 0);
+        }
+      flott_matrix_work (&worker[0]);
+
+      for (i = 0; i < thread_count; i++)
+        {
+          if (worker[i].started == true)
+            {
+              flott_thread_join (&(worker[i].thread));
+            }
+          flott_deinitialize (&(worker[i].object));
+        }
+    }
+
+  /* turn per-transform quantities into distances */
+  for (i = 0; i < count && queue.ret_val == FLOTT_SUCCESS; i++)
+    {
+      if (type == FLOTT_MATRIX_NTI)
+        {
+          for (j = 0; j < count; j++)
+            {
+              matrix[i * count + j] = flott_nid (matrix[i * count + j],
+                                                 queue.solo[i], queue.solo[j]);
+            }
+        }
+      else
+        {
+          for (j = i; j < count; j++)
+            {
+              distance = flott_max_M (matrix[i * count + j]
+                                      - (queue.solo[j] + 1),
+                                      matrix[j * count + i]
+                                      - (queue.solo[i] + 1))
+                         / flott_max_M (queue.solo[i], queue.solo[j]);
+
+              // clamp floating point precision errors
+              distance = flott_min_M (distance, 1.0);
+              distance = flott_max_M (distance, 0.0);
+              matrix[i * count + j] = distance;
+              matrix[j * count + i] = distance;
+            }
+        }
+    }
+
+  flott_matrix_close_sources (op, queue.source);
+  flott_mutex_destroy (&queue.mutex);
+  flott_deallocate (op->allocator, queue.source);
+  flott_deallocate (op->allocator, queue.solo);
+  flott_deallocate (op->allocator, worker);
+
+  return queue.ret_val;
+}
+
+/**
+ * store the 'size' low order bytes of 'value' at 'buffer' in little-endian
+ * byte order
+ */
+static void
+flott_matrix_store_le (unsigned char *buffer, flott_uint64 value, int size)
+{
+  int i;
+  for (i = 0; i < size; i++)
+    {
+      buffer[i] = (unsigned char) (value >> (i << 3));
+    }
+}
+
+/**
+ * write a 'count' x 'count' distance matrix to 'handle'.
+ *
+ * The binary format is FLOTT_MATRIX_MAGIC (8 bytes), the format version and
+ * distance type as 32-bit unsigned integers, 'count' as 64-bit unsigned
+ * integer, followed by the row-major matrix as IEEE 754 doubles; all fields
+ * are little-endian, like the binary step records. Text formats label
+ * rows (and columns) with 'label[i]'; PHYLIP names are padded to 10
+ * characters, longer names are kept (relaxed PHYLIP). 'precision' is the
+ * number of fractional digits of text output.
+ */
+int
+flott_matrix_write (FILE *handle, flott_matrix_format format,
+                    flott_matrix_type type, const double *matrix,
+                    size_t count, const char **label, int precision)
+{
+  int ret_val = FLOTT_SUCCESS;
+  unsigned char buffer[64 << 3];     ///< header, then 64 doubles at a time
+  flott_uint64 bits;
+  char separator = (format == FLOTT_MATRIX_TAB) ? '\t' : ',';
+  size_t i, j, length;
+
+  if (handle == NULL || (matrix == NULL && count > 0))
+    {
+      return FLOTT_ERR_NULL_POINTER;
+    }
+
+  switch (format)
+    {
+      case FLOTT_MATRIX_BINARY :
+        memcpy (buffer, FLOTT_MATRIX_MAGIC, 8);
+        flott_matrix_store_le (&buffer[8], FLOTT_MATRIX_VERSION, 4);
+        flott_matrix_store_le (&buffer[12], (flott_uint64) type, 4);
+        flott_matrix_store_le (&buffer[16], (flott_uint64) count, 8);
+        length = FLOTT_MATRIX_HDRSZ;
+        for (i = 0; i < count * count && ret_val == FLOTT_SUCCESS; i++)
+          {
+            memcpy (&bits, &matrix[i], 8);
+            flott_matrix_store_le (&buffer[length], bits, 8);
+            length += 8;
+            if (length == sizeof (buffer) || i + 1 == count * count)
+              {
+                if (fwrite (buffer, 1, length, handle) != length)
+                  {
+                    ret_val = FLOTT_ERR_WRITING_FILE;
+                  }
+                length = 0;
+              }
+          }
+        if (length > 0 && fwrite (buffer, 1, length, handle) != length)
+          {
+            ret_val = FLOTT_ERR_WRITING_FILE; ///< empty matrix, header only
+          }
+        break;
+      case FLOTT_MATRIX_CSV :
+      case FLOTT_MATRIX_TAB :
+        fprintf (handle, "%s", (type == FLOTT_MATRIX_NTI) ? "nti" : "ntc");
+        for (j = 0; j < count; j++)
+          {
+            fprintf (handle, "%c%s", separator, label[j]);
+          }
+        fprintf (handle, "\n");
+        for (i = 0; i < count; i++)
+          {
+            fprintf (handle, "%s", label[i]);
+            for (j = 0; j < count; j++)
+              {
+                fprintf (handle, "%c%.*f", separator, precision,
+                         matrix[i * count + j]);
+              }
+            fprintf (handle, "\n");
+          }
+        break;
+      case FLOTT_MATRIX_PHYLIP :
+        fprintf (handle, "%5lu\n", (unsigned long) count);
+        for (i = 0; i < count; i++)
+          {
+            fprintf (handle, "%-10s", label[i]);
+            for (j = 0; j < count; j++)
+              {
+                fprintf (handle, " %.*f", precision, matrix[i * count + j]);
+              }
+            fprintf (handle, "\n");
+          }
+        break;
+      default :
+        ret_val = FLOTT_ERR_INVALID_OPT;
+        break;
+    }
+
+  if (ret_val == FLOTT_SUCCESS && ferror (handle))
+    {
+      ret_val = FLOTT_ERR_WRITING_FILE;
+    }
+
+  return ret_val;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef _FLOTT_MATRIX_H_
+#define _FLOTT_MATRIX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#define FLOTT_MATRIX_TILE     8          ///< tile edge length (input sources)
+#define FLOTT_MATRIX_MAGIC    "FLOTTMAT" ///< binary matrix file signature
+#define FLOTT_MATRIX_VERSION  2          ///< binary matrix file version
+#define FLOTT_MATRIX_HDRSZ    24         ///< binary matrix header size (bytes)
+
+typedef enum flott_matrix_type flott_matrix_type;
+typedef enum flott_matrix_format flott_matrix_format;
+
+/**
+ * all-pairs distance measures
+ */
+enum flott_matrix_type
+{
+  FLOTT_MATRIX_NTI = 0,  ///< normalized t-information distance
+  FLOTT_MATRIX_NTC = 1   ///< normalized t-complexity distance
+};
+
+/**
+ * distance matrix file formats
+ */
+enum flott_matrix_format
+{
+  FLOTT_MATRIX_BINARY = 0, ///< header followed by row-major doubles (LE)
+  FLOTT_MATRIX_CSV    = 1, ///< comma separated, labeled rows and columns
+  FLOTT_MATRIX_TAB    = 2, ///< tab separated, labeled rows and columns
+  FLOTT_MATRIX_PHYLIP = 3  ///< square PHYLIP distance matrix
+};
+
+int flott_matrix (flott_object *op, flott_matrix_type type,
+                  size_t thread_count, double *matrix);
+int flott_matrix_write (FILE *handle, flott_matrix_format format,
+                        flott_matrix_type type, const double *matrix,
+                        size_t count, const char **label, int precision);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLOTT_MATRIX_H_ */
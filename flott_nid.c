@@ -17,15 +17,26 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "flott.h"
 #include "flott_nid.h"
+#include "flott_thread.h"
+#include "flott_util.h"
 
-/**
- * external prototype definitions
- */
-extern void flott_t_transform_simple (flott_object *op);
-extern void flott_t_transform_callback (flott_object *op);
+#define FLOTT_NID_ALIGN 64 ///< alignment of workspaces sharing an allocation
+
+typedef struct flott_nid_worker flott_nid_worker;
+
+struct flott_nid_worker
+{
+  flott_object object;      ///< single source object, borrowed workspace
+  flott_source source;      ///< copy of input source 'a' or 'b'
+  size_t member;            ///< single member input sequence
+  flott_thread thread;
+  bool started;
+  int ret_val;
+};
 
 double
 flott_nid (double ab, double a, double b)
@@ -44,6 +55,181 @@ flott_nid (double ab, double a, double b)
   return ret_val;
 }
 
+static void *
+flott_nid_work (void *argument)
+{
+  flott_nid_worker *worker = (flott_nid_worker *) argument;
+  char *bytes = worker->source.data.bytes;
+
+  worker->ret_val = flott_t_transform_cached (&(worker->object),
+                                              FLOTT_OBSERVE_NONE);
+
+  /* release data the engine loaded/mapped for this input */
+  if (worker->source.data.bytes != bytes)
+    {
+      if (worker->source.storage_type == FLOTT_DEV_FILE_TO_MEM)
+        {
+          flott_deallocate (worker->object.allocator,
+                            worker->source.data.bytes);
+        }
+      else if (worker->source.storage_type == FLOTT_DEV_MMAP)
+        {
+          flott_unmap_file (worker->source.data.bytes, worker->source.length);
+        }
+    }
+  worker->source.data.bytes = NULL; ///< never release data owned by 'op'
+
+  return NULL;
+}
+
+/**
+ * get the t-information of 'ab' (concatenated as set up in 'op'), 'a' and
+ * 'b' concurrently. 'a' and 'b' are transformed on two threads in disjoint
+ * regions of one allocation: with three or more threads 'ab' runs alongside
+ * in the workspace of 'op' (about twice the memory of a serial run),
+ * otherwise 'ab' goes first and its workspace is reused for 'a' and 'b'
+ * (it only needs to grow by the space of one set of level-zero headers).
+ */
+static int
+flott_nti_dist_parallel (flott_object *op, const size_t *member,
+                         double *t_information)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_nid_worker worker[2];
+  flott_object *object;
+  size_t size[2];
+  char *block = NULL;
+  char *workspace;
+  size_t i;
+
+  if (member[0] >= op->input.count || member[1] >= op->input.count)
+    {
+      return flott_set_status (op, FLOTT_ERR_INDEX_BOUNDS, FLOTT_VL_FATAL,
+                               " (sequence index)");
+    }
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+
+  memset (worker, 0, sizeof (worker));
+  for (i = 0; i < 2; i++)
+    {
+      object = &(worker[i].object);
+      worker[i].source = op->input.source[member[i]];
+      object->input.symbol_type = op->input.symbol_type;
+      object->input.append_termchar = true;
+      object->verbosity_level = op->verbosity_level;
+      object->handler.error = op->handler.error;
+      object->handler.message = op->handler.message;
+      object->user = op->user;
+      object->cache = op->cache;
+      object->allocator = op->allocator;
+      object->input.count = 1;
+      object->input.source = &(worker[i].source);
+      object->input.sequence.length = 1;
+      object->input.sequence.member = &(worker[i].member);
+
+      size[i] = flott_get_workspace_size (worker[i].source.length,
+                                          op->input.symbol_type);
+      size[i] = (size[i] + FLOTT_NID_ALIGN - 1) & ~((size_t) FLOTT_NID_ALIGN - 1);
+    }
+
+  if (op->thread_count >= 3)
+    {
+      block = (char *) flott_allocate (op->allocator, size[0] + size[1]);
+    }
+  workspace = block;
+
+  if (workspace != NULL)
+    {
+      /* 'a' and 'b' concurrently with 'ab' */
+      flott_set_workspace (&(worker[0].object), workspace, size[0]);
+      flott_set_workspace (&(worker[1].object), workspace + size[0], size[1]);
+      for (i = 0; i < 2; i++)
+        {
+          worker[i].started = (flott_thread_create (&(worker[i].thread),
+                                                    flott_nid_work,
+                                                    &worker[i]) == 0);
+        }
+      ret_val = flott_t_transform_cached (op, FLOTT_OBSERVE_NONE);
+      t_information[0] = op->result.t_information;
+      for (i = 0; i < 2; i++)
+        {
+          if (worker[i].started == true)
+            {
+              flott_thread_join (&(worker[i].thread));
+            }
+          else
+            {
+              flott_nid_work (&worker[i]);
+            }
+        }
+    }
+  else
+    {
+      /* 'ab' first, then 'a' and 'b' concurrently in its workspace */
+      ret_val = flott_t_transform_cached (op, FLOTT_OBSERVE_NONE);
+      t_information[0] = op->result.t_information;
+      if (ret_val == FLOTT_SUCCESS)
+        {
+          workspace = (char *) flott_reserve_workspace (op, size[0] + size[1]);
+          if (workspace == NULL) /* borrowed workspace too small */
+            {
+              workspace = block = (char *) flott_allocate (op->allocator,
+                                                           size[0] + size[1]);
+            }
+        }
+      if (workspace != NULL)
+        {
+          flott_set_workspace (&(worker[0].object), workspace, size[0]);
+          flott_set_workspace (&(worker[1].object), workspace + size[0],
+                               size[1]);
+          worker[0].started = (flott_thread_create (&(worker[0].thread),
+                                                    flott_nid_work,
+                                                    &worker[0]) == 0);
+          flott_nid_work (&worker[1]);
+          if (worker[0].started == true)
+            {
+              flott_thread_join (&(worker[0].thread));
+            }
+          else
+            {
+              flott_nid_work (&worker[0]);
+            }
+        }
+      else if (ret_val == FLOTT_SUCCESS)
+        {
+          ret_val = flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT,
+                                      FLOTT_VL_FATAL, " (token list)");
+        }
+    }
+
+  /* report the first failing transform: ab, a, b */
+  for (i = 0; i < 2; i++)
+    {
+      t_information[i + 1] = worker[i].object.result.t_information;
+      if (ret_val == FLOTT_SUCCESS && worker[i].ret_val != FLOTT_SUCCESS)
+        {
+          ret_val = worker[i].ret_val;
+          op->status = worker[i].object.status;
+        }
+      flott_deinitialize (&(worker[i].object));
+    }
+  flott_deallocate (op->allocator, block);
+
+  /* leave 'op' as a serial run would: set up for (and holding) 'b' */
+  op->input.append_termchar = true;
+  op->result = worker[1].object.result;
+  op->input.length = worker[1].object.input.length;
+  if (ret_val == FLOTT_SUCCESS && op->handler.init != NULL)
+    {
+      ret_val = op->handler.init (op);
+    }
+
+  return ret_val;
+}
+
 int
 flott_nti_dist (flott_object *op, double *nti_dist)
 {
@@ -51,22 +237,39 @@ flott_nti_dist (flott_object *op, double *nti_dist)
   double t_information_a;
   double t_information_b;
   double t_information_ab;
+  size_t pair[2] = {0, 1};
+  size_t length = (op->input.sequence.length > 0) ? op->input.sequence.length
+                                                   : op->input.count;
 
   *nti_dist = -1.0;
-  ret_val = flott_initialize (op);
 
-  if (ret_val == FLOTT_SUCCESS
-      && op->input.sequence.length == 2)
+  if (length == 2)
     {
-      op->input.append_termchar = true;
-      op->handler.progress = NULL;
-
       flott_sequence tmp_sequence;
       size_t index;
 
+      op->handler.progress = NULL;
+
+      if (op->thread_count > 1)
+        {
+          double t_information[3];
+
+          tmp_sequence.member = (op->input.sequence.length > 0)
+                                ? op->input.sequence.member : pair;
+          ret_val = flott_nti_dist_parallel (op, tmp_sequence.member,
+                                             t_information);
+          if (ret_val == FLOTT_SUCCESS)
+            {
+              *nti_dist = flott_nid (t_information[0], t_information[1],
+                                     t_information[2]);
+            }
+          return ret_val;
+        }
+
       /* get t-information for file/memory location 'a' concatenated with 'b' */
-      flott_t_transform_simple (op);
+      ret_val = flott_t_transform_cached (op, FLOTT_OBSERVE_NONE);
       t_information_ab = op->result.t_information;
+      op->input.append_termchar = true;
 
       /* reuse already allocated token list memory */
       tmp_sequence = op->input.sequence;
@@ -74,21 +277,17 @@ flott_nti_dist (flott_object *op, double *nti_dist)
       op->input.sequence.length = 1;
 
       /* get t-information for file/memory location 'a' */
-      index = tmp_sequence.member[0];
-      ret_val = flott_initialize (op);
-      if (ret_val == FLOTT_SUCCESS)
+      index = (tmp_sequence.length > 0) ? tmp_sequence.member[0] : pair[0];
+      if (ret_val == FLOTT_SUCCESS
+          && (ret_val = flott_t_transform_cached (op, FLOTT_OBSERVE_NONE))
+             == FLOTT_SUCCESS)
         {
-          flott_t_transform_simple (op);
           t_information_a = op->result.t_information;
 
           /* get t-information for file/memory location 'b' */
-          index = tmp_sequence.member[1];
-          ret_val = flott_initialize (op);
-          if (ret_val == FLOTT_SUCCESS)
-            {
-              flott_t_transform_simple (op);
-              t_information_b = op->result.t_information;
-            }
+          index = (tmp_sequence.length > 0) ? tmp_sequence.member[1] : pair[1];
+          ret_val = flott_t_transform_cached (op, FLOTT_OBSERVE_NONE);
+          t_information_b = op->result.t_information;
         }
 
       op->input.sequence = tmp_sequence;
@@ -106,22 +305,6 @@ flott_nti_dist (flott_object *op, double *nti_dist)
   return ret_val;
 }
 
-void
-flott_ntc_dist_step(flott_object *op, flott_token* cp_last, const flott_uint level,
-                   const size_t cf_value, const size_t cp_start_offset,
-                   const size_t cp_length, const size_t joined_cp_length,
-                   const double t_complexity, int *terminate)
-{
-  flott_user_stop_sequence *stop_sequence =
-                            (flott_user_stop_sequence *) (op->user);
-  if (cp_start_offset <= stop_sequence->offset)
-    {
-
-      stop_sequence->t_complexity = t_complexity;// - log(cf_value + 1) / log(2.0);
-      op->handler.step = NULL;
-    }
-}
-
 int
 flott_ntc_dist (flott_object *op, double *ntc_dist)
 {
@@ -130,8 +313,7 @@ flott_ntc_dist (flott_object *op, double *ntc_dist)
   double t_complexity_b;
   double t_complexity_agb;
   double t_complexity_bga;
-  flott_user_stop_sequence stop_sequence;
-  void *user = op->user;
+  flott_boundary boundary = op->boundary;
 
   *ntc_dist = -1.0;
 
@@ -148,36 +330,41 @@ flott_ntc_dist (flott_object *op, double *ntc_dist)
       op->input.source[2].storage_type = FLOTT_DEV_STOP_SYMBOL;
       op->input.source[2].length = 1;
 
-      op->input.sequence.deallocate = true; ///< auto deallocation
-      op->input.sequence.member =
-          (size_t *) malloc (op->input.count * sizeof (size_t));
+      /* reuse the sequence list of an earlier call */
+      if (op->input.sequence.deallocate == false
+          || op->input.sequence.length != op->input.count)
+        {
+          if (op->input.sequence.deallocate == true)
+            {
+              flott_deallocate (op->allocator, op->input.sequence.member);
+            }
+          op->input.sequence.deallocate = true; ///< auto deallocation
+          op->input.sequence.member =
+              (size_t *) flott_allocate (op->allocator,
+                                         op->input.count * sizeof (size_t));
+        }
       if (op->input.sequence.member != NULL)
         {
           op->input.sequence.length = op->input.count;
           op->input.sequence.member[0] = 1;
           op->input.sequence.member[1] = 2;
           op->input.sequence.member[2] = 0;
-          stop_sequence.offset = op->input.source[1].length;
+          op->boundary.offset = op->input.source[1].length;
           if ((ret_val = flott_initialize (op)) == FLOTT_SUCCESS)
             {
-              op->user = (void *) &stop_sequence;
-              op->handler.step = &flott_ntc_dist_step;
-              flott_t_transform_callback (op);
-              t_complexity_a = stop_sequence.t_complexity - 1;
-              t_complexity_bga = op->result.t_complexity - stop_sequence.t_complexity;
+              flott_t_transform_policy (op, FLOTT_OBSERVE_BOUNDARY);
+              t_complexity_a = op->boundary.t_complexity - 1;
+              t_complexity_bga = op->result.t_complexity - op->boundary.t_complexity;
             }
 
           op->input.sequence.member[0] = 0;
           op->input.sequence.member[2] = 1;
-          stop_sequence.offset = op->input.source[0].length;
-          op->user = user;
+          op->boundary.offset = op->input.source[0].length;
           if ((ret_val = flott_initialize (op)) == FLOTT_SUCCESS)
             {
-              op->user = (void*) &stop_sequence;
-              op->handler.step = &flott_ntc_dist_step;
-              flott_t_transform_callback (op);
-              t_complexity_b = stop_sequence.t_complexity - 1;
-              t_complexity_agb = op->result.t_complexity - stop_sequence.t_complexity;
+              flott_t_transform_policy (op, FLOTT_OBSERVE_BOUNDARY);
+              t_complexity_b = op->boundary.t_complexity - 1;
+              t_complexity_agb = op->result.t_complexity - op->boundary.t_complexity;
 
               *ntc_dist = flott_max_M(t_complexity_agb, t_complexity_bga)
                           / flott_max_M(t_complexity_a, t_complexity_b);
@@ -189,11 +376,131 @@ flott_ntc_dist (flott_object *op, double *ntc_dist)
         }
       else
         {
+          op->input.sequence.length = 0;
           ret_val = flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT,
                                       FLOTT_VL_FATAL, " (sequence list)");
         }
     }
-  op->user = user;
+  op->boundary = boundary;
   return ret_val;
 }
 
+
+/**
+ * get the conditional t-complexities C(s_i | s_i+1 .. s_K) of the K input
+ * sources s_1 .. s_K of the input sequence of 'op' (all sources if empty) in
+ * a single t-transform of s_1.#1.s_2.#2 .. #K-1.s_K, where #i are distinct
+ * stop symbols. The cumulative t-complexity is captured as the parse crosses
+ * each boundary; 't_complexity[i]' receives C(s_i+1 | s_i+2 .. s_K) for
+ * i < K - 1 and 't_complexity[K - 1]' the (unconditional) C(s_K). For K = 2
+ * these are the quantities 'flott_ntc_dist' derives from one of its
+ * transforms. The input sources of 'op' are not modified, other than data
+ * the engine loads or maps for them.
+ */
+int
+flott_conditional_t_complexity (flott_object *op, double *t_complexity)
+{
+  int ret_val;
+  size_t count, i, index, offset;
+  flott_input input = op->input;
+  flott_boundary boundary = op->boundary;
+  flott_progress_handler *progress = op->handler.progress;
+  flott_source *source;
+  size_t *member, *boundary_offset;
+  double *boundary_t_complexity;
+  int shift = (op->input.symbol_type == FLOTT_SYMBOL_BIT) ? 3 : 0;
+
+  count = (input.sequence.length > 0) ? input.sequence.length : input.count;
+  if (count < 2)
+    {
+      return flott_set_status (op, FLOTT_ERR_NID_NUM_INPUTS, FLOTT_VL_FATAL);
+    }
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+
+  /* sources interleaved with stop symbols, sequence and boundaries */
+  source = (flott_source *) flott_allocate (op->allocator, (2 * count - 1)
+                                             * sizeof (flott_source));
+  member = (size_t *) flott_allocate (op->allocator,
+                                      (3 * count - 2) * sizeof (size_t));
+  boundary_t_complexity =
+      (double *) flott_allocate (op->allocator, (count - 1) * sizeof (double));
+  if (source == NULL || member == NULL || boundary_t_complexity == NULL)
+    {
+      flott_deallocate (op->allocator, source);
+      flott_deallocate (op->allocator, member);
+      flott_deallocate (op->allocator, boundary_t_complexity);
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (conditional t-complexity)");
+    }
+  memset (source, 0, (2 * count - 1) * sizeof (flott_source));
+  boundary_offset = &member[2 * count - 1];
+
+  offset = 0;
+  for (i = 0; i < count; i++)
+    {
+      index = (input.sequence.length > 0) ? input.sequence.member[i] : i;
+      if (index >= input.count)
+        {
+          flott_deallocate (op->allocator, source);
+          flott_deallocate (op->allocator, member);
+          flott_deallocate (op->allocator, boundary_t_complexity);
+          return flott_set_status (op, FLOTT_ERR_INDEX_BOUNDS, FLOTT_VL_FATAL,
+                                   " (sequence index)");
+        }
+      source[2 * i] = input.source[index];
+      member[2 * i] = 2 * i;
+      offset += input.source[index].length << shift;
+      if (i < count - 1)
+        {
+          source[2 * i + 1].storage_type = FLOTT_DEV_STOP_SYMBOL;
+          source[2 * i + 1].length = 1;
+          member[2 * i + 1] = 2 * i + 1;
+          boundary_offset[i] = offset++;
+        }
+    }
+
+  op->input.source = source;
+  op->input.count = 2 * count - 1;
+  op->input.sequence.member = member;
+  op->input.sequence.length = 2 * count - 1;
+  op->input.sequence.deallocate = false;
+  op->input.append_termchar = true;
+  op->handler.progress = NULL;
+  op->boundary.count = count - 1;
+  op->boundary.offsets = boundary_offset;
+  op->boundary.t_complexities = boundary_t_complexity;
+
+  if ((ret_val = flott_initialize (op)) == FLOTT_SUCCESS)
+    {
+      flott_t_transform_policy (op, FLOTT_OBSERVE_BOUNDARY);
+
+      t_complexity[0] = op->result.t_complexity - boundary_t_complexity[0];
+      for (i = 1; i < count - 1; i++)
+        {
+          t_complexity[i] = boundary_t_complexity[i - 1]
+                            - boundary_t_complexity[i] - 1;
+        }
+      t_complexity[count - 1] = boundary_t_complexity[count - 2] - 1;
+    }
+
+  /* hand back data loaded/mapped by the engine */
+  for (i = 0; i < count; i++)
+    {
+      index = (input.sequence.length > 0) ? input.sequence.member[i] : i;
+      input.source[index].data = source[2 * i].data;
+      input.source[index].start_offset = source[2 * i].start_offset;
+      input.source[index].end_offset = source[2 * i].end_offset;
+    }
+
+  op->input = input;
+  op->boundary = boundary;
+  op->handler.progress = progress;
+  flott_deallocate (op->allocator, source);
+  flott_deallocate (op->allocator, member);
+  flott_deallocate (op->allocator, boundary_t_complexity);
+
+  return ret_val;
+}
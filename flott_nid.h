@@ -23,17 +23,10 @@
 extern "C" {
 #endif
 
-typedef struct flott_user_stop_sequence flott_user_stop_sequence;
-
-struct flott_user_stop_sequence
-{
-  flott_uint offset;
-  flott_token *boundary_token;
-  double t_complexity;
-};
-
+double flott_nid (double ab, double a, double b);
 int flott_nti_dist (flott_object *op, double *nti_dist);
 int flott_ntc_dist (flott_object *op, double *ntc_dist);
+int flott_conditional_t_complexity (flott_object *op, double *t_complexity);
 
 #ifdef __cplusplus
 }
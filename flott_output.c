@@ -16,7 +16,9 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "flott.h"
 #include "flott_output.h"
 #include "flott_math.h"
@@ -32,6 +34,9 @@
 #define FLOTT_OUT_CP_ORD        9
 #define FLOTT_OUT_T_NID_ORD    FLOTT_OUT_ORD_SZ - 1
 
+#define FLOTT_OUT_MAX_PRECISION 300 ///< max. precision of fast formatting
+#define FLOTT_OUT_MAX_COLUMN    640 ///< max. formatted column length
+
 /**
  * function macros (indicated by '_M' suffix)
  */
@@ -42,10 +47,11 @@
       *column_separator = output->column_separator; \
     }
 
-#define flott_col_sprintf_M(option, format, value) \
+#define flott_col_format_M(option, format_call) \
     if (flott_bitset_M (options, option)) \
     { \
-      i += sprintf (&line_buffer[i], (format), column_separator, value); \
+      if (*column_separator != '\0') *tail++ = *column_separator; \
+      tail = (format_call); \
       *column_separator = output->column_separator; \
     }
 
@@ -82,6 +88,298 @@ const static char* flott_col_label_G[FLOTT_OUT_ORD_SZ] =
   "t-{dist}"  ///< normalized t-information distance
 };
 
+const static char* flott_bin_label_G[3] =
+{
+  "t-{r}min", ///< binned instantaneous t-entropy rates
+  "t-{r}avg",
+  "t-{r}max"
+};
+
+/**
+ * write the pending step output text to the output device
+ */
+static void
+flott_output_flush (flott_user_output *output)
+{
+  if (output->text_length > 0)
+    {
+      fwrite (output->text, 1, output->text_length, output->handle);
+      output->text_length = 0;
+    }
+}
+
+/**
+ * get a pointer to the end of the step output text, with room for at least
+ * 'length' bytes
+ */
+static FLOTT_INLINE char *
+flott_output_reserve (flott_user_output *output, size_t length)
+{
+  if (output->text_length + length > FLOTT_OUT_TEXT_BUFSZ)
+    {
+      flott_output_flush (output);
+    }
+  return &(output->text[output->text_length]);
+}
+
+/**
+ * format 'value' right aligned in a column of 'width' characters at 'text',
+ * same as printf's "%*zu", and return the end of the formatted text
+ */
+static FLOTT_INLINE char *
+flott_output_format_uint (char *text, size_t value, int width)
+{
+  char digit[24];
+  int length = 0;
+
+  do
+    {
+      digit[length++] = (char) ('0' + value % 10);
+      value /= 10;
+    }
+  while (value > 0);
+
+  for (; width > length; width--) *text++ = ' ';
+  while (length > 0) *text++ = digit[--length];
+
+  return text;
+}
+
+/**
+ * format 'value' right aligned in a column of 'width' characters with
+ * 'precision' decimal digits at 'text', same as printf's "%*.*f", and return
+ * the end of the formatted text. Digits are generated exactly from the
+ * binary fraction and rounded half to even like glibc does; values that do
+ * not fit the integer fast path are left to 'sprintf', as is any value on
+ * platforms with different printf rounding.
+ */
+static char *
+flott_output_format_double (char *text, double value, int width,
+                            int precision)
+{
+#ifndef _MSC_VER
+  char fraction[FLOTT_OUT_MAX_PRECISION];
+  char digit[24];
+  flott_uint64 integer, bits, half;
+  double magnitude;
+  int negative, shift, exponent, length, i;
+
+  magnitude = fabs (value);
+  if (magnitude < 9.0e18 && precision <= FLOTT_OUT_MAX_PRECISION)
+    {
+      negative = signbit (value) ? 1 : 0;
+      integer = (flott_uint64) magnitude;
+      magnitude -= (double) integer; ///< exact, the fraction has fewer bits
+
+      /* fraction as 'bits' / 2^'shift' */
+      bits = 0;
+      shift = 0;
+      if (magnitude > 0.0)
+        {
+          bits = (flott_uint64) ldexp (frexp (magnitude, &exponent), 53);
+          shift = 53 - exponent;
+          while (shift > 60 && (bits & 1) == 0)
+            {
+              bits >>= 1;
+              shift--;
+            }
+        }
+
+      if (shift <= 60)
+        {
+          /* multiply fraction by ten for every decimal digit */
+          for (i = 0; i < precision; i++)
+            {
+              bits *= 10;
+              fraction[i] = (char) ('0' + (bits >> shift));
+              bits &= (((flott_uint64) 1 << shift) - 1);
+            }
+
+          /* round remainder half to even */
+          half = (shift > 0) ? ((flott_uint64) 1 << (shift - 1)) : 1;
+          if ( bits > half
+               || (bits == half && (((precision > 0)
+                                     ? fraction[precision - 1] : integer) & 1)) )
+            {
+              for (i = precision - 1; i >= 0 && fraction[i] == '9'; i--)
+                {
+                  fraction[i] = '0';
+                }
+              if (i >= 0) fraction[i]++;
+              else integer++;
+            }
+
+          length = 0;
+          do
+            {
+              digit[length++] = (char) ('0' + integer % 10);
+              integer /= 10;
+            }
+          while (integer > 0);
+
+          for (i = negative + length + ((precision > 0) ? precision + 1 : 0);
+               i < width; i++)
+            {
+              *text++ = ' ';
+            }
+          if (negative) *text++ = '-';
+          while (length > 0) *text++ = digit[--length];
+          if (precision > 0)
+            {
+              *text++ = '.';
+              memcpy (text, fraction, precision);
+              text += precision;
+            }
+          return text;
+        }
+    }
+#endif /* _MSC_VER */
+
+  return text + sprintf (text, "%*.*f", width, precision, value);
+}
+
+/**
+ * store the 'size' low order bytes of 'value' at 'buffer' in little-endian
+ * byte order
+ */
+static void
+flott_output_store_le (unsigned char *buffer, flott_uint64 value, int size)
+{
+  int i;
+  for (i = 0; i < size; i++)
+    {
+      buffer[i] = (unsigned char) (value >> (i << 3));
+    }
+}
+
+/**
+ * determine the binary record column set from the output options, binary
+ * records hold the same numeric columns as the corresponding text rows
+ */
+static flott_uint
+flott_output_binary_columns (const flott_object *op)
+{
+  flott_user_output *output = (flott_user_output *) (op->user);
+  flott_output_options allowed = ( FLOTT_OUT_T_AUG_LEVEL
+                                 | FLOTT_OUT_T_COMPLEXITY
+                                 | FLOTT_OUT_T_INFORMATION
+                                 | FLOTT_OUT_AVE_T_ENTROPY );
+  flott_uint columns = 0;
+  int i;
+
+  if (op->window.size > 0)
+    {
+      allowed |= FLOTT_OUT_INPUT_OFFSET;
+    }
+  else if (output->options & FLOTT_OUT_STEP)
+    {
+      allowed = ~((flott_output_options) 0);
+    }
+
+  for (i = 0; i < FLOTT_OUT_CP_ORD; i++)
+    {
+      if (flott_bitset_M (output->options & allowed, flott_col_ordinal_G[i]))
+        {
+          columns |= (1u << i);
+        }
+    }
+
+  return columns;
+}
+
+/**
+ * patch the record count into the header of the open binary section, the
+ * count stays 0 if the output device is not seekable
+ */
+static void
+flott_output_binary_finish (flott_user_output *output)
+{
+  unsigned char count[8];
+  long position;
+
+  if (output->binary_section > 0
+      && (position = ftell (output->handle)) >= 0
+      && fseek (output->handle, output->binary_section - 1
+                                + FLOTT_OUT_BINARY_HDRSZ - 8, SEEK_SET) == 0)
+    {
+      flott_output_store_le (count, output->binary_count, 8);
+      fwrite (count, 1, 8, output->handle);
+      fseek (output->handle, position, SEEK_SET);
+    }
+  output->binary_section = 0;
+}
+
+/**
+ * close the open binary section and start a new one
+ */
+static void
+flott_output_binary_header (const flott_object *op)
+{
+  flott_user_output *output = (flott_user_output *) (op->user);
+  flott_uint columns = output->binary_columns;
+  flott_uint record_size = 0;
+  unsigned char header[FLOTT_OUT_BINARY_HDRSZ];
+  long position;
+  int i;
+
+  flott_output_binary_finish (output);
+
+  for (i = 0; i < FLOTT_OUT_CP_ORD; i++)
+    {
+      record_size += ((columns >> i) & 1) << 3;
+    }
+
+  memcpy (header, FLOTT_OUT_BINARY_MAGIC, 8);
+  flott_output_store_le (&header[8], FLOTT_OUT_BINARY_VERSION, 4);
+  flott_output_store_le (&header[12], columns, 4);
+  flott_output_store_le (&header[16],
+      flott_bitset_M (output->options, FLOTT_OUT_UNITS_BITS), 4);
+  flott_output_store_le (&header[20], record_size, 4);
+  flott_output_store_le (&header[24], op->input.length, 8);
+  flott_output_store_le (&header[32], ///< a result section has one record
+      (op->window.size == 0 && !(output->options & FLOTT_OUT_STEP)), 8);
+
+  position = ftell (output->handle);
+  fwrite (header, 1, FLOTT_OUT_BINARY_HDRSZ, output->handle);
+  output->binary_section = (position >= 0) ? position + 1 : 0;
+  output->binary_count = 0;
+}
+
+/**
+ * write a binary record, taking the columns in 'output->binary_columns' from
+ * 'int_value' (integer ordinals) and 'double_value' (double ordinals, offset
+ * by FLOTT_OUT_DBL_ORD)
+ */
+static void
+flott_output_binary_row (flott_user_output *output, const size_t *int_value,
+                         const double *double_value)
+{
+  unsigned char row[FLOTT_OUT_CP_ORD << 3];
+  flott_uint64 bits;
+  size_t length = 0;
+  int i;
+
+  for (i = 0; i < FLOTT_OUT_CP_ORD; i++)
+    {
+      if ((output->binary_columns >> i) & 1)
+        {
+          if (i < FLOTT_OUT_DBL_ORD)
+            {
+              bits = (flott_uint64) int_value[i];
+            }
+          else
+            {
+              memcpy (&bits, &double_value[i - FLOTT_OUT_DBL_ORD], 8);
+            }
+          flott_output_store_le (&row[length], bits, 8);
+          length += 8;
+        }
+    }
+
+  fwrite (row, 1, length, output->handle);
+  output->binary_count++;
+}
+
 int
 flott_set_output_device (flott_object *op)
 {
@@ -100,6 +398,10 @@ flott_set_output_device (flott_object *op)
               /*TODO: throw proper error message */
               ret_val = flott_set_status (op, FLOTT_ERROR, FLOTT_VL_FATAL);
             }
+          else /* fewer, larger writes for the many small copy patterns */
+            {
+              setvbuf (output->handle, NULL, _IOFBF, FLOTT_OUT_TEXT_BUFSZ);
+            }
         }
         break;
       default : /* we got an invalid output option */
@@ -129,6 +431,16 @@ flott_output_initialize (flott_object *op)
 
   output->previous_t_information = 0.0;
   output->previous_input_offset = op->input.length - 1;
+  output->bin_offset = 0;
+  if (output->bin_size > 0 && op->input.length > 1)
+    {
+      output->bin_offset = ((op->input.length - 2) / output->bin_size)
+                           * output->bin_size;
+    }
+  output->bin_count = 0;
+  output->bin_min = HUGE_VAL;
+  output->bin_sum = 0.0;
+  output->bin_max = -HUGE_VAL;
   output->scale_factor = 1.0;
   if (flott_bitset_M (output->options, FLOTT_OUT_UNITS_BITS))
     {
@@ -140,10 +452,16 @@ flott_output_initialize (flott_object *op)
 
   /* set column separating charter */
   switch (output->options
-         & (FLOTT_OUT_PRETTY | FLOTT_OUT_CSV | FLOTT_OUT_TAB))
+         & (FLOTT_OUT_PRETTY | FLOTT_OUT_CSV | FLOTT_OUT_TAB | FLOTT_OUT_BINARY))
     {
       case FLOTT_OUT_CSV : output->column_separator = ','; break;
       case FLOTT_OUT_TAB : output->column_separator = '\t'; break;
+      case FLOTT_OUT_BINARY :
+        {
+          output->column_separator = ' ';
+          output->binary_columns = flott_output_binary_columns (op);
+        }
+        break;
       case FLOTT_OUT_PRETTY :
       default :
         {
@@ -208,6 +526,9 @@ flott_output_initialize (flott_object *op)
                output->precision);
       sprintf (output->short_double, "%%s%%%d.%df", sdouble_sz,
                output->precision);
+      output->int_width = int_sz;
+      output->double_width = double_sz;
+      output->sdouble_width = sdouble_sz;
 
       /* generate column header line */
       if (flott_bitset_M (output->options, FLOTT_OUT_HEADERS))
@@ -248,6 +569,29 @@ flott_output_initialize (flott_object *op)
                   *column_separator = output->column_separator;
                 }
             }
+
+          /* binned rates replace the t-augmentation step columns */
+          if (output->bin_size > 0)
+            {
+              line_length = sprintf (output->column_header, "%*s", int_sz,
+                                     flott_col_label_G[0]);
+              for (i = FLOTT_OUT_DBL_ORD; i < FLOTT_OUT_SDBL_ORD; i++)
+                {
+                  if (flott_bitset_M (output->options, flott_col_ordinal_G[i]))
+                    {
+                      line_length += sprintf (
+                          &(output->column_header[line_length]), "%c%*s",
+                          output->column_separator, double_sz,
+                          flott_col_label_G[i]);
+                    }
+                }
+              for (i = 0; i < 3; i++)
+                {
+                  line_length += sprintf (&(output->column_header[line_length]),
+                                          "%c%*s", output->column_separator,
+                                          sdouble_sz, flott_bin_label_G[i]);
+                }
+            }
         }
     }
   else
@@ -261,7 +605,11 @@ flott_output_initialize (flott_object *op)
 void flott_output_print_headers (const flott_object *op)
 {
   flott_user_output *output = (flott_user_output *) (op->user);
-  if (flott_bitset_M (output->options, FLOTT_OUT_HEADERS))
+  if (flott_bitset_M (output->options, FLOTT_OUT_BINARY))
+    {
+      flott_output_binary_header (op); ///< binary output is self-describing
+    }
+  else if (flott_bitset_M (output->options, FLOTT_OUT_HEADERS))
     {
       if (*(output->column_header) != '\0' && output->handle != NULL)
         {
@@ -307,7 +655,70 @@ int flott_output_ntc_dist (flott_object *op)
   return ret_val;
 }
 
-void flott_output_no_rate (flott_object *op)
+int flott_output_matrix (flott_object *op)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_user_output *output = (flott_user_output *) (op->user);
+  flott_output_options options = output->options;
+  flott_matrix_type type = flott_bitset_M (options, FLOTT_OUT_NTC_DIST)
+                           ? FLOTT_MATRIX_NTC : FLOTT_MATRIX_NTI;
+  flott_matrix_format format = FLOTT_MATRIX_PHYLIP;
+  size_t count = op->input.count;
+  const char **label;
+  char *names;
+  double *matrix;
+  size_t i;
+
+  if (flott_bitset_M (options, FLOTT_OUT_BINARY))   format = FLOTT_MATRIX_BINARY;
+  else if (flott_bitset_M (options, FLOTT_OUT_CSV)) format = FLOTT_MATRIX_CSV;
+  else if (flott_bitset_M (options, FLOTT_OUT_TAB)) format = FLOTT_MATRIX_TAB;
+
+  /* label files by path, strings by their position on the command line */
+  matrix = (double *) malloc (count * count * sizeof (double));
+  label = (const char **) malloc (count * sizeof (char *));
+  names = (char *) malloc (count * 24);
+  if (matrix == NULL || label == NULL || names == NULL)
+    {
+      free (matrix);
+      free (label);
+      free (names);
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (distance matrix)");
+    }
+  for (i = 0; i < count; i++)
+    {
+      if (op->input.source[i].path != NULL)
+        {
+          label[i] = op->input.source[i].path;
+        }
+      else
+        {
+          sprintf (&names[i * 24], "S%lu", (unsigned long) (i + 1));
+          label[i] = &names[i * 24];
+        }
+    }
+
+  if ((ret_val = flott_matrix (op, type, op->thread_count, matrix))
+      == FLOTT_SUCCESS)
+    {
+      ret_val = flott_matrix_write (output->handle, format, type, matrix,
+                                    count, label, output->precision);
+      if (ret_val != FLOTT_SUCCESS)
+        {
+          ret_val = flott_set_status (op, ret_val, FLOTT_VL_FATAL,
+                                      " (distance matrix)");
+        }
+    }
+
+  free (matrix);
+  free (label);
+  free (names);
+
+  return ret_val;
+}
+
+static void
+flott_output_result (flott_object *op, const flott_result *result)
 {
   flott_user_output *output = (flott_user_output *) (op->user);
   flott_uint options = output->options;
@@ -317,56 +728,221 @@ void flott_output_no_rate (flott_object *op)
   char* short_double = output->short_double;
   char column_separator[2] = "";
 
-  flott_uint levels;
+  size_t levels;
   double t_complexity, t_information, t_entropy;
 
+  /* scale results to 'nats'/'bits' */
+  levels = result->levels;
+  t_complexity = result->t_complexity;
+  t_information = result->t_information / output->scale_factor;
+  t_entropy = result->t_entropy / output->scale_factor;
+
+  flott_output_print_headers (op);
+  if (flott_bitset_M (options, FLOTT_OUT_BINARY))
+    {
+      size_t int_value[FLOTT_OUT_DBL_ORD] = {0, levels, 0, 0, 0};
+      double double_value[] = {t_complexity, t_information, t_entropy, 0.0};
+      flott_output_binary_row (output, int_value, double_value);
+      return;
+    }
+
+  flott_col_printf_M (FLOTT_OUT_T_AUG_LEVEL, basic_int, levels);
+  flott_col_printf_M (FLOTT_OUT_T_COMPLEXITY, basic_double, t_complexity);
+  flott_col_printf_M (FLOTT_OUT_T_INFORMATION, basic_double, t_information);
+  flott_col_printf_M (FLOTT_OUT_AVE_T_ENTROPY, short_double, t_entropy);
+
+  fprintf(output->handle, "\n");
+}
+
+void flott_output_no_rate (flott_object *op)
+{
   if (op->input.length > 0)
     {
-      op->handler.step = NULL; ///< no t-augmentation step output
-      flott_t_transform (op);
+      flott_output_result (op, &(op->result));
+    }
+}
 
-      /* scale results to 'nats'/'bits' */
-      levels = op->result.levels;
-      t_complexity = op->result.t_complexity;
-      t_information = op->result.t_information / output->scale_factor;
-      t_entropy = op->result.t_entropy / output->scale_factor;
+/**
+ * initialize 'op' for step output, or get the result of a simple output run
+ * (from the result cache if possible)
+ */
+static int
+flott_output_prepare (flott_object *op)
+{
+  flott_user_output *output = (flott_user_output *) (op->user);
 
-      flott_output_print_headers (op);
-      flott_col_printf_M (FLOTT_OUT_T_AUG_LEVEL, basic_int, (size_t) levels);
-      flott_col_printf_M (FLOTT_OUT_T_COMPLEXITY, basic_double, t_complexity);
-      flott_col_printf_M (FLOTT_OUT_T_INFORMATION, basic_double, t_information);
-      flott_col_printf_M (FLOTT_OUT_AVE_T_ENTROPY, short_double, t_entropy);
+  if (output->options & FLOTT_OUT_STEP)
+    {
+      return flott_initialize (op);
+    }
 
-      fprintf(output->handle, "\n");
+  op->handler.record = NULL; ///< no t-augmentation step output
+  if (output->profile_path != NULL)
+    {
+      int ret_val = flott_initialize (op);
+      if (ret_val == FLOTT_SUCCESS)
+        {
+          ret_val = flott_t_transform_profile_file (op, output->profile_path);
+        }
+      return ret_val;
     }
+  return flott_t_transform_cached (op, flott_get_observer_policy (op));
 }
 
-void
-flott_output_step (flott_object *op, flott_token* cp_last, const flott_uint level,
-                   const size_t cf_value, const size_t cp_start_offset,
-                   const size_t cp_length, const size_t joined_cp_length,
-                   const double t_complexity, int *terminate)
+static int
+flott_output_batch (flott_object *op)
 {
+  int ret_val = FLOTT_SUCCESS;
   flott_user_output *output = (flott_user_output *) (op->user);
+  flott_result *result;
+  size_t member;
+
+  result = (flott_result *) malloc (op->input.count * sizeof (flott_result));
+  if (result == NULL)
+    {
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (batch results)");
+    }
+
+  if ((ret_val = flott_batch (op, op->thread_count, result)) == FLOTT_SUCCESS)
+    {
+      /* print results in input order */
+      op->_private.ln2 = log (2.0);
+      for (member = 0; member < op->input.count && ret_val == FLOTT_SUCCESS;
+           member++)
+        {
+          /* set up output formats as if the input was initialized */
+          op->input.length = op->input.source[member].length;
+          if (op->input.symbol_type == FLOTT_SYMBOL_BIT)
+            {
+              op->input.length <<= 3;
+            }
+          if (op->handler.init != NULL
+              && (ret_val = op->handler.init (op)) != FLOTT_SUCCESS)
+            {
+              break;
+            }
+
+          if ( (output->options & FLOTT_OUT_PRETTY)
+               &&  *(output->column_header) != '\0' )
+            {
+              fprintf (output->handle,
+                       "input #%" FLOTT_PRINTF_T_SIZE_T ":\n" , member + 1);
+            }
+          if (op->input.source[member].length > 0)
+            {
+              flott_output_result (op, &result[member]);
+            }
+          if (!flott_bitset_M (output->options, FLOTT_OUT_BINARY))
+            {
+              fprintf (output->handle, "\n");
+            }
+        }
+    }
+
+  free (result);
+  return ret_val;
+}
+
+/**
+ * accumulate the instantaneous t-entropy 'rate' of a t-augmentation step
+ * over the input offsets it covers, ['input_offset', previous input offset),
+ * and write a row for every bin the step completes: the bin's first input
+ * offset, the t-complexity and t-information there (if selected), and the
+ * min., mean and max. rate over the bin
+ */
+static void
+flott_output_bin (flott_user_output *output, size_t input_offset,
+                  double t_complexity, double t_information, double rate)
+{
   flott_uint options = output->options;
-  FILE *output_handle = output->handle;
+  size_t offset = output->previous_input_offset;
+  size_t lower;
+  char *text;
+
+  while (offset > input_offset)
+    {
+      lower = flott_max_M (input_offset, output->bin_offset);
+      output->bin_min = flott_min_M (output->bin_min, rate);
+      output->bin_max = flott_max_M (output->bin_max, rate);
+      output->bin_sum += rate * (double) (offset - lower);
+      output->bin_count += offset - lower;
+      offset = lower;
+
+      if (offset == output->bin_offset) /* bin is complete */
+        {
+          text = flott_output_reserve (output, 6 * FLOTT_OUT_MAX_COLUMN);
+          text = flott_output_format_uint (text, offset, output->int_width);
+          if (flott_bitset_M (options, FLOTT_OUT_T_COMPLEXITY))
+            {
+              *text++ = output->column_separator;
+              text = flott_output_format_double (text, t_complexity,
+                         output->double_width, output->precision);
+            }
+          if (flott_bitset_M (options, FLOTT_OUT_T_INFORMATION))
+            {
+              *text++ = output->column_separator;
+              text = flott_output_format_double (text, t_information,
+                         output->double_width, output->precision);
+            }
+          *text++ = output->column_separator;
+          text = flott_output_format_double (text, output->bin_min,
+                     output->sdouble_width, output->precision);
+          *text++ = output->column_separator;
+          text = flott_output_format_double (text,
+                     output->bin_sum / (double) output->bin_count,
+                     output->sdouble_width, output->precision);
+          *text++ = output->column_separator;
+          text = flott_output_format_double (text, output->bin_max,
+                     output->sdouble_width, output->precision);
+          *text++ = '\n';
+          output->text_length = (size_t) (text - output->text);
+
+          output->bin_count = 0;
+          output->bin_min = HUGE_VAL;
+          output->bin_sum = 0.0;
+          output->bin_max = -HUGE_VAL;
+          if (output->bin_offset >= output->bin_size)
+            {
+              output->bin_offset -= output->bin_size;
+            }
+        }
+    }
+  output->previous_input_offset = input_offset;
+}
+
+static void
+flott_output_step (flott_object *op, const flott_step_record *record,
+                   int *terminate)
+{
+  flott_user_output *output = (flott_user_output *) (op->user);
+  const size_t level = record->level;
+  const size_t cf_value = record->copy_factor;
+  const size_t cp_start_offset = record->cp_offset;
+  const size_t cp_length = record->cp_length;
+  const size_t joined_cp_length = record->joined_length;
+  const double t_complexity = record->t_complexity;
+  flott_uint options = output->options;
+  const int int_width = output->int_width;
+  const int precision = output->precision;
   size_t i = 0;
-  size_t input_offset;
-  char* line_buffer = output->line_buffer;
-  char* basic_int = output->basic_int;
-  char* basic_double = output->basic_double;
-  char* short_double = output->short_double;
+  size_t input_offset = 0;
+  size_t tail_length;
+  char *tail, *text;
   char column_separator[2] = "";
-  double t_information;
-  double t_entropy;
-  double t_inst_entropy;
+  double t_information = 0.0;
+  double t_entropy = 0.0;
+  double t_inst_entropy = 0.0;
 
   /* check if t-information has to be calculated */
-  if ( options & (FLOTT_OUT_T_INFORMATION | FLOTT_OUT_AVE_T_ENTROPY
-                                          | FLOTT_OUT_INST_T_ENTROPY) )
+  if ( (options & (FLOTT_OUT_T_INFORMATION | FLOTT_OUT_AVE_T_ENTROPY
+                                           | FLOTT_OUT_INST_T_ENTROPY))
+       || output->bin_size > 0 )
   {
       t_information =
-          flott_get_t_information (t_complexity) / output->scale_factor;
+          flott_get_t_information_fast (t_complexity,
+                                        FLOTT_T_INFORMATION_TOLERANCE)
+          / output->scale_factor;
 
       t_entropy =
           t_information / ( (op->_private.token_list.length - cp_start_offset)
@@ -377,71 +953,167 @@ flott_output_step (flott_object *op, flott_token* cp_last, const flott_uint leve
       output->previous_t_information = t_information;
   }
 
+  if (flott_bitset_M (options, FLOTT_OUT_BINARY))
+    {
+      size_t int_value[FLOTT_OUT_DBL_ORD] =
+        {cp_start_offset + cp_length - joined_cp_length, level, cf_value,
+         cp_start_offset, cp_length};
+      double double_value[] =
+        {t_complexity, t_information, t_entropy, t_inst_entropy};
+      flott_output_binary_row (output, int_value, double_value);
+      return;
+    }
+
+  if (output->bin_size > 0)
+    {
+      flott_output_bin (output, cp_start_offset + cp_length - joined_cp_length,
+                        t_complexity, t_information, t_inst_entropy);
+      return;
+    }
+
+  /* format the columns following the input offset once, they are repeated
+   * on the interpolated rows */
+  tail = output->row_tail;
+  *column_separator = flott_bitset_M (options, FLOTT_OUT_INPUT_OFFSET)
+                      ? output->column_separator : '\0';
+  flott_col_format_M (FLOTT_OUT_T_AUG_LEVEL,
+                      flott_output_format_uint (tail, level, int_width));
+  flott_col_format_M (FLOTT_OUT_CF,
+                      flott_output_format_uint (tail, cf_value, int_width));
+  flott_col_format_M (FLOTT_OUT_CP_OFFSET,
+                      flott_output_format_uint (tail, cp_start_offset,
+                                                int_width));
+  flott_col_format_M (FLOTT_OUT_CP_LENGTH,
+                      flott_output_format_uint (tail, cp_length, int_width));
+  flott_col_format_M (FLOTT_OUT_T_COMPLEXITY,
+                      flott_output_format_double (tail, t_complexity,
+                          output->double_width, precision));
+  flott_col_format_M (FLOTT_OUT_T_INFORMATION,
+                      flott_output_format_double (tail, t_information,
+                          output->double_width, precision));
+  flott_col_format_M (FLOTT_OUT_AVE_T_ENTROPY,
+                      flott_output_format_double (tail, t_entropy,
+                          output->sdouble_width, precision));
+  flott_col_format_M (FLOTT_OUT_INST_T_ENTROPY,
+                      flott_output_format_double (tail, t_inst_entropy,
+                          output->sdouble_width, precision));
+  tail_length = (size_t) (tail - output->row_tail);
+
   /* check if output needs to be interpolated (i.e. fill the gaps) */
   if (flott_bitset_M (output->options, FLOTT_OUT_INPUT_OFFSET))
   {
-     /* buffer boundary check from 'output_init' applies here too */
-    flott_col_sprintf_M (FLOTT_OUT_INPUT_OFFSET, "%s%s", basic_int);
-    flott_col_sprintf_M (FLOTT_OUT_T_AUG_LEVEL, basic_int, (size_t) level);
-    flott_col_sprintf_M (FLOTT_OUT_CF, basic_int, cf_value);
-    flott_col_sprintf_M (FLOTT_OUT_CP_OFFSET, basic_int, cp_start_offset);
-    flott_col_sprintf_M (FLOTT_OUT_CP_LENGTH, basic_int, cp_length);
-    flott_col_sprintf_M (FLOTT_OUT_T_COMPLEXITY, basic_double, t_complexity);
-    flott_col_sprintf_M (FLOTT_OUT_T_INFORMATION, basic_double, t_information);
-    flott_col_sprintf_M (FLOTT_OUT_AVE_T_ENTROPY, short_double, t_entropy);
-    flott_col_sprintf_M (FLOTT_OUT_INST_T_ENTROPY, short_double, t_inst_entropy);
-
-    *column_separator = '\0';
     input_offset = (cp_start_offset + cp_length - joined_cp_length);
     for (i = output->previous_input_offset - 1; i > input_offset; i--)
       {
-        fprintf (output_handle, line_buffer, column_separator, i);
+        text = flott_output_reserve (output, tail_length + int_width + 32);
+        text = flott_output_format_uint (text, i, int_width);
+        memcpy (text, output->row_tail, tail_length);
+        text += tail_length;
         if (flott_bitset_M (options, FLOTT_OUT_CP_STRING))
           {
-            //*column_separator = output->column_separator;
             if (flott_bitset_M (options, FLOTT_OUT_PRETTY))
               {
-                fprintf (output_handle, "%2c.", output->column_separator);
+                *text++ = ' ';
+                *text++ = output->column_separator;
+                *text++ = '.';
               }
             else
               {
-                fprintf (output_handle, "%c", output->column_separator);
+                *text++ = output->column_separator;
               }
           }
-        fprintf (output_handle, "\n");
+        *text++ = '\n';
+        output->text_length = (size_t) (text - output->text);
       }
     output->previous_input_offset = input_offset;
   }
 
-  flott_col_printf_M (FLOTT_OUT_INPUT_OFFSET, basic_int, input_offset);
-  flott_col_printf_M (FLOTT_OUT_T_AUG_LEVEL, basic_int, (size_t) level);
-  flott_col_printf_M (FLOTT_OUT_CF, basic_int, cf_value);
-  flott_col_printf_M (FLOTT_OUT_CP_OFFSET, basic_int, cp_start_offset);
-  flott_col_printf_M (FLOTT_OUT_CP_LENGTH, basic_int, cp_length);
-  flott_col_printf_M (FLOTT_OUT_T_COMPLEXITY, basic_double, t_complexity);
-  flott_col_printf_M (FLOTT_OUT_T_INFORMATION, basic_double, t_information);
-  flott_col_printf_M (FLOTT_OUT_AVE_T_ENTROPY, short_double, t_entropy);
-  flott_col_printf_M (FLOTT_OUT_INST_T_ENTROPY, short_double, t_inst_entropy);
+  text = flott_output_reserve (output, tail_length + int_width + 32);
+  if (flott_bitset_M (options, FLOTT_OUT_INPUT_OFFSET))
+    {
+      text = flott_output_format_uint (text, input_offset, int_width);
+    }
+  memcpy (text, output->row_tail, tail_length);
+  text += tail_length;
 
   if (flott_bitset_M (options, FLOTT_OUT_CP_STRING))
     {
       if (flott_bitset_M (options, FLOTT_OUT_PRETTY))
         {
-          fprintf (output_handle, "%2s", column_separator);
+          *text++ = ' ';
+          *text++ = ' ';
         }
-      else
+      else if (*column_separator != '\0')
         {
-          fprintf (output_handle, "%s", column_separator);
+          *text++ = *column_separator;
         }
+      output->text_length = (size_t) (text - output->text);
+      flott_output_flush (output);
 
       /* TODO: check return value & set terminate on error */
       *terminate = false;
       flott_input_write ((flott_object *) op,
                          cp_start_offset,
                          cp_length,
-                         output_handle);
+                         output->handle);
+      text = flott_output_reserve (output, 1);
     }
-  fprintf(output_handle, "\n");
+  *text++ = '\n';
+  output->text_length = (size_t) (text - output->text);
+}
+
+void
+flott_output_window (flott_object *op, const size_t window_offset,
+                     const flott_result *result, int *terminate)
+{
+  flott_user_output *output = (flott_user_output *) (op->user);
+  flott_uint options = output->options;
+  FILE *output_handle = output->handle;
+  char* basic_int = output->basic_int;
+  char* basic_double = output->basic_double;
+  char* short_double = output->short_double;
+  char column_separator[2] = "";
+
+  size_t levels = result->levels;
+  double t_complexity = result->t_complexity;
+  double t_information = result->t_information / output->scale_factor;
+  double t_entropy = result->t_entropy / output->scale_factor;
+
+  /* column headers are available once the first window is done */
+  if (window_offset == 0)
+    {
+      flott_output_print_headers (op);
+    }
+
+  if (flott_bitset_M (options, FLOTT_OUT_BINARY))
+    {
+      size_t int_value[FLOTT_OUT_DBL_ORD] = {window_offset, levels, 0, 0, 0};
+      double double_value[] = {t_complexity, t_information, t_entropy, 0.0};
+      flott_output_binary_row (output, int_value, double_value);
+      return;
+    }
+
+  flott_col_printf_M (FLOTT_OUT_INPUT_OFFSET, basic_int, window_offset);
+  flott_col_printf_M (FLOTT_OUT_T_AUG_LEVEL, basic_int, levels);
+  flott_col_printf_M (FLOTT_OUT_T_COMPLEXITY, basic_double, t_complexity);
+  flott_col_printf_M (FLOTT_OUT_T_INFORMATION, basic_double, t_information);
+  flott_col_printf_M (FLOTT_OUT_AVE_T_ENTROPY, short_double, t_entropy);
+
+  fprintf (output_handle, "\n");
+}
+
+void
+flott_output_records (flott_object *op, const flott_step_record *record,
+                      const size_t count, int *terminate)
+{
+  size_t i;
+
+  /* write a buffer full of t-augmentation steps */
+  for (i = 0; i < count && *terminate == false; i++)
+    {
+      flott_output_step (op, &record[i], terminate);
+    }
+  flott_output_flush ((flott_user_output *) (op->user));
 }
 
 int flott_output (flott_object *op)
@@ -450,20 +1122,41 @@ int flott_output (flott_object *op)
   flott_user_output *output = (flott_user_output *) (op->user);
   size_t member;
 
+  /* sliding window t-entropy time series */
+  if (op->window.size > 0)
+    {
+      op->handler.progress = NULL; ///< no progress bar;
+      return flott_t_transform_window (op);
+    }
+
   if (flott_bitset_M (output->options, FLOTT_OUT_CONCAT_INPUT))
     {
-      ret_val = flott_initialize (op);
+      ret_val = flott_output_prepare (op);
       if (output->options & FLOTT_OUT_STEP)
         {
           op->handler.progress = NULL; ///< no progress bar;
           flott_output_print_headers (op);
-          flott_t_transform (op);
+          if (ret_val == FLOTT_SUCCESS && output->profile_path != NULL)
+            {
+              ret_val = flott_t_transform_profile_file (op,
+                                                        output->profile_path);
+            }
+          else if (ret_val == FLOTT_SUCCESS)
+            {
+              flott_t_transform (op);
+            }
         }
       else /* simple output (no t-augmentation step output ) */
         {
           flott_output_no_rate (op);
         }
     }
+  else if ( op->thread_count > 1 && op->input.count > 1
+            && !(output->options & FLOTT_OUT_STEP) )
+    {
+      /* transform independent inputs concurrently */
+      ret_val = flott_output_batch (op);
+    }
   else
     {
       op->input.sequence.deallocate = false;
@@ -472,7 +1165,10 @@ int flott_output (flott_object *op)
 
       for (member = 0; member < op->input.count; member++)
         {
-          if ((ret_val = flott_initialize (op)) != FLOTT_SUCCESS)
+          /* let the OS read the next inputs while this one is transformed */
+          flott_prefetch_input (op, member);
+
+          if ((ret_val = flott_output_prepare (op)) != FLOTT_SUCCESS)
             {
               break;
             }
@@ -494,7 +1190,10 @@ int flott_output (flott_object *op)
               flott_output_no_rate (op);
             }
 
-          if (member != op->input.count) fprintf (output->handle, "\n");
+          if (!flott_bitset_M (output->options, FLOTT_OUT_BINARY))
+            {
+              fprintf (output->handle, "\n");
+            }
         }
     }
 
@@ -507,6 +1206,7 @@ flott_output_destroy (const flott_object *op)
   flott_user_output *output = (flott_user_output *) (op->user);
   if (output != NULL && output->handle != NULL)
      {
+       flott_output_binary_finish (output);
        if (output->handle != stdout)
          {
            fclose (output->handle);
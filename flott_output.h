@@ -31,6 +31,21 @@ extern "C" {
  * constant 'define' macros
  */
 #define FLOTT_COLFORM_BUFSZ 64      ///< size of number format buffer
+#define FLOTT_OUT_RECORD_BUFSZ 1024 ///< number of buffered step records
+#define FLOTT_OUT_TEXT_BUFSZ (1 << 16) ///< size of step output text buffer
+#define FLOTT_OUT_TAIL_BUFSZ 8192   ///< size of formatted step columns buffer
+
+/* binary output ('-F=bin'): one section per output stream, a 40-byte header
+ * (magic, u32 version, u32 column set, u32 units, u32 record size,
+ * u64 input length, u64 record count) followed by fixed-size records of
+ * 8-byte little-endian fields: u64 integer and IEEE 754 double columns in
+ * column ordinal order. Bit i of the column set marks ordinal i as present
+ * (x, n, k, p-{o}, p-{l}, t-{c}, t-{i}, t-{e}, t-{r}), units are 1 for bits
+ * and 0 for nats. The record count of step and sliding window sections is 0
+ * if the output was not seekable (i.e. records extend to the end of file). */
+#define FLOTT_OUT_BINARY_MAGIC "FLOTTSTP"
+#define FLOTT_OUT_BINARY_VERSION 1
+#define FLOTT_OUT_BINARY_HDRSZ 40
 
 /**
  * user type definitions for console application
@@ -66,7 +81,11 @@ enum flott_output_options
 
   FLOTT_OUT_PRETTY                   = 1 << 16,
   FLOTT_OUT_CSV                      = 1 << 17,
-  FLOTT_OUT_TAB                      = 1 << 18
+  FLOTT_OUT_TAB                      = 1 << 18,
+  FLOTT_OUT_PHYLIP                   = 1 << 19,
+  FLOTT_OUT_BINARY                   = 1 << 20,
+
+  FLOTT_OUT_MATRIX                   = 1 << 21
 };
 
 struct flott_user_output
@@ -79,16 +98,39 @@ struct flott_user_output
   double previous_t_information;
   size_t previous_input_offset;
 
+  size_t bin_size;       ///< input offsets per row of binned rates (0: off)
+  size_t bin_offset;     ///< first input offset of the open bin
+  size_t bin_count;      ///< input offsets accumulated in the open bin
+  double bin_min;        ///< min., sum and max. instantaneous t-entropy rate
+  double bin_sum;        ///< of the open bin
+  double bin_max;
+
   char column_separator; ///< column separator character
   char column_header[FLOTT_LINE_BUFSZ];   ///< buffer for column header string
   char line_buffer[FLOTT_LINE_BUFSZ];   ///< buffer for column header string
   char basic_int[FLOTT_COLFORM_BUFSZ];    ///< buffer for 'int' format string
   char basic_double[FLOTT_COLFORM_BUFSZ]; ///< buffer for 'double' format string
   char short_double[FLOTT_COLFORM_BUFSZ]; ///< format buffer of t-entropy format string
+  int int_width;         ///< column width of 'basic_int'
+  int double_width;      ///< column width of 'basic_double'
+  int sdouble_width;     ///< column width of 'short_double'
+
+  char row_tail[FLOTT_OUT_TAIL_BUFSZ]; ///< step columns following offset 'x'
+  char text[FLOTT_OUT_TEXT_BUFSZ];     ///< step output text buffer
+  size_t text_length;                  ///< bytes pending in 'text'
+
+  flott_step_record
+    records[FLOTT_OUT_RECORD_BUFSZ]; ///< t-augmentation step record buffer
 
   flott_storage_type storage_type; ///< device type the output is written to
   char* path;
   FILE *handle; ///< output device file handle
+  char* cache_path; ///< result cache file (see 'flott_cache_open')
+  char* profile_path; ///< t-complexity profile file (see 'flott_profile.h')
+
+  flott_uint binary_columns;  ///< binary record column set (bit: ordinal)
+  long binary_section;        ///< offset + 1 of open binary header (0: none)
+  flott_uint64 binary_count;  ///< records written to the open section
 };
 
 /**
@@ -99,11 +141,12 @@ int flott_output_initialize (flott_object *op);
 void flott_output_print_headers (const flott_object *op);
 int flott_output_nti_dist (flott_object *op);
 int flott_output_ntc_dist (flott_object *op);
+int flott_output_matrix (flott_object *op);
 void flott_output_no_rate (flott_object *op);
-void flott_output_step (flott_object *op, flott_token* cp_last, const flott_uint level,
-                        const size_t cf_value, const size_t cp_start_offset,
-                        const size_t cp_length, const size_t joined_cp_length,
-                        const double t_complexity, int *terminate);
+void flott_output_records (flott_object *op, const flott_step_record *record,
+                           const size_t count, int *terminate);
+void flott_output_window (flott_object *op, const size_t window_offset,
+                          const flott_result *result, int *terminate);
 int flott_output (flott_object *op);
 void flott_output_destroy (const flott_object *op);
 void flott_output_progress_bar (const flott_object *op, const float ratio);
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "flott.h"
+#include "flott_profile.h"
+#include "flott_util.h"
+
+/**
+ * t-transform the initialized object 'op' and write its suffix t-complexity
+ * profile to file 'path', as a raw array of 'flott_profile_point' (host byte
+ * order). The engine writes the points straight into a shared mapping of
+ * the file, which is sized for the worst case of one point per token and
+ * truncated to the points actually written afterwards. All other observers
+ * of 'op' (e.g. a step handler for step output) stay in effect.
+ */
+int
+flott_t_transform_profile_file (flott_object *op, const char *path)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_profile profile = op->profile;
+  size_t size = op->_private.token_list.length;
+  char *data;
+
+  if (flott_map_output_file (path, size * sizeof (flott_profile_point), &data)
+      != 0)
+    {
+      return flott_set_status (op, FLOTT_ERR_WRITING_FILE, FLOTT_VL_FATAL,
+                               " (t-complexity profile)");
+    }
+
+  op->profile.point = (flott_profile_point *) data;
+  op->profile.size = size;
+  op->profile.count = 0;
+  flott_t_transform (op);
+
+  flott_unmap_file (data, size * sizeof (flott_profile_point));
+  if (flott_resize_file (path, op->profile.count * sizeof (flott_profile_point))
+      != 0)
+    {
+      ret_val = flott_set_status (op, FLOTT_ERR_WRITING_FILE, FLOTT_VL_FATAL,
+                                  " (t-complexity profile)");
+    }
+
+  profile.count = op->profile.count;
+  op->profile = profile;
+
+  return ret_val;
+}
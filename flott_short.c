@@ -0,0 +1,111 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+#include "flott.h"
+#include "flott_short.h"
+
+/**
+ * external prototype definitions
+ */
+extern void flott_t_transform_simple (flott_object *op);
+
+/**
+ * t-transform an array of short input strings, writing t-complexity and
+ * t-information of 'input[i]' to 't_complexity[i]' and 't_information[i]'
+ * (either result array may be NULL).
+ *
+ * Symbol type, terminal character, verbosity and error/message handlers are
+ * taken from 'op' (may be NULL). Inputs are t-transformed in 'workspace'; if
+ * 'workspace' is NULL a stack buffer of FLOTT_SHORT_STACK_SZ bytes is used.
+ * Inputs up to FLOTT_SHORT_MAX_LENGTH symbols are run on the 16-bit offset
+ * engine, longer inputs (or inputs exceeding the workspace) fall back to a
+ * single heap block that is reused for the remainder of the batch.
+ */
+int
+flott_short_batch (flott_object *op, const flott_short_input *input,
+                   size_t count, void *workspace, size_t workspace_size,
+                   double *t_complexity, double *t_information)
+{
+  int ret_val = FLOTT_SUCCESS;
+  uint64_t stack_workspace[FLOTT_SHORT_STACK_SZ / sizeof (uint64_t)];
+  flott_object batch_op;
+  flott_source source;
+  size_t member = 0;
+  size_t i;
+
+  /* set up a single source object on the stack */
+  memset (&batch_op, 0, sizeof (flott_object));
+  memset (&source, 0, sizeof (flott_source));
+  batch_op.input.symbol_type = FLOTT_SYMBOL_BYTE;
+  batch_op.verbosity_level = FLOTT_VL_FATAL;
+  if (op != NULL)
+    {
+      batch_op.input.symbol_type = op->input.symbol_type;
+      batch_op.input.append_termchar = op->input.append_termchar;
+      batch_op.verbosity_level = op->verbosity_level;
+      batch_op.handler.error = op->handler.error;
+      batch_op.handler.message = op->handler.message;
+      batch_op.user = op->user;
+    }
+
+  source.storage_type = FLOTT_DEV_MEM;
+  batch_op.input.count = 1;
+  batch_op.input.source = &source;
+  batch_op.input.sequence.length = 1;
+  batch_op.input.sequence.member = &member;
+
+  /* use the caller's workspace, or else the stack */
+  if (workspace == NULL)
+    {
+      workspace = stack_workspace;
+      workspace_size = sizeof (stack_workspace);
+    }
+  flott_set_workspace (&batch_op, workspace, workspace_size);
+
+  for (i = 0; i < count; i++)
+    {
+      source.data.bytes = input[i].bytes;
+      source.length = input[i].length;
+
+      if ((ret_val = flott_initialize (&batch_op)) != FLOTT_SUCCESS)
+        {
+          break;
+        }
+      flott_t_transform_simple (&batch_op);
+
+      if (t_complexity != NULL)
+        {
+          t_complexity[i] = batch_op.result.t_complexity;
+        }
+      if (t_information != NULL)
+        {
+          t_information[i] = batch_op.result.t_information;
+        }
+    }
+
+  /* release heap memory of inputs that did not fit into the workspace */
+  flott_deinitialize (&batch_op);
+
+  if (ret_val != FLOTT_SUCCESS && op != NULL)
+    {
+      op->status = batch_op.status;
+    }
+
+  return ret_val;
+}
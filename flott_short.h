@@ -0,0 +1,49 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef _FLOTT_SHORT_H_
+#define _FLOTT_SHORT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * constant 'define' macros
+ */
+#define FLOTT_SHORT_MAX_LENGTH \
+    (FLOTT_UINT16_MAX - FLOTT_SYMBOL_BYTE - 3) ///< longest 16-bit engine input
+#define FLOTT_SHORT_STACK_SZ (64 * 1024)   ///< size of stack workspace in bytes
+
+typedef struct flott_short_input flott_short_input;
+
+struct flott_short_input
+{
+  char *bytes;    ///< pointer to input string
+  size_t length;  ///< length of input string in bytes
+};
+
+int flott_short_batch (flott_object *op, const flott_short_input *input,
+                       size_t count, void *workspace, size_t workspace_size,
+                       double *t_complexity, double *t_information);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLOTT_SHORT_H_ */
@@ -120,6 +120,7 @@ flott_get_options (flott_getopt_object *op)
                    * so we may need to do some re-writing here at some point */
                   if (++(op->optind) < argc
                       && !(argv[op->optind][0] == '-'
+                          && argv[op->optind][1] != '\0' ///< lone '-' is stdin
                           && strchr ((op->tpl), (int)(argv[op->optind][1])) != NULL)
                      )
                     {
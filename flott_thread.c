@@ -0,0 +1,320 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "flott_thread.h"
+
+#ifndef _MSC_VER
+  #include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+static DWORD WINAPI
+flott_thread_start (LPVOID argument)
+{
+  flott_thread *thread = (flott_thread *) argument;
+  thread->result = thread->routine (thread->argument);
+  return 0;
+}
+#else
+static void *
+flott_thread_start (void *argument)
+{
+  flott_thread *thread = (flott_thread *) argument;
+  thread->result = thread->routine (thread->argument);
+  return thread->result;
+}
+#endif
+
+/**
+ * start 'routine (argument)' in a new thread, returns 0 on success
+ */
+int
+flott_thread_create (flott_thread *thread, flott_thread_routine *routine,
+                     void *argument)
+{
+  int ret_val = 0;
+
+  thread->routine = routine;
+  thread->argument = argument;
+  thread->result = NULL;
+
+#ifdef _MSC_VER
+  thread->handle = CreateThread (NULL, 0, flott_thread_start, thread, 0, NULL);
+  ret_val = (thread->handle == NULL);
+#else
+  ret_val = pthread_create (&(thread->handle), NULL, flott_thread_start, thread);
+#endif
+
+  return ret_val;
+}
+
+/**
+ * wait for thread to finish, returns 0 on success
+ */
+int
+flott_thread_join (flott_thread *thread)
+{
+  int ret_val = 0;
+
+#ifdef _MSC_VER
+  ret_val = (WaitForSingleObject (thread->handle, INFINITE) != WAIT_OBJECT_0);
+  CloseHandle (thread->handle);
+#else
+  ret_val = pthread_join (thread->handle, NULL);
+#endif
+
+  return ret_val;
+}
+
+/**
+ * initialize a (non-recursive) mutex, returns 0 on success
+ */
+int
+flott_mutex_init (flott_mutex *mutex)
+{
+#ifdef _MSC_VER
+  InitializeCriticalSection (&(mutex->handle));
+  return 0;
+#else
+  return pthread_mutex_init (&(mutex->handle), NULL);
+#endif
+}
+
+void
+flott_mutex_lock (flott_mutex *mutex)
+{
+#ifdef _MSC_VER
+  EnterCriticalSection (&(mutex->handle));
+#else
+  pthread_mutex_lock (&(mutex->handle));
+#endif
+}
+
+void
+flott_mutex_unlock (flott_mutex *mutex)
+{
+#ifdef _MSC_VER
+  LeaveCriticalSection (&(mutex->handle));
+#else
+  pthread_mutex_unlock (&(mutex->handle));
+#endif
+}
+
+void
+flott_mutex_destroy (flott_mutex *mutex)
+{
+#ifdef _MSC_VER
+  DeleteCriticalSection (&(mutex->handle));
+#else
+  pthread_mutex_destroy (&(mutex->handle));
+#endif
+}
+
+/**
+ * initialize a condition variable, returns 0 on success
+ */
+int
+flott_cond_init (flott_cond *cond)
+{
+#ifdef _MSC_VER
+  InitializeConditionVariable (&(cond->handle));
+  return 0;
+#else
+  return pthread_cond_init (&(cond->handle), NULL);
+#endif
+}
+
+/**
+ * wait for 'cond' to be signaled, 'mutex' has to be locked by the caller
+ */
+void
+flott_cond_wait (flott_cond *cond, flott_mutex *mutex)
+{
+#ifdef _MSC_VER
+  SleepConditionVariableCS (&(cond->handle), &(mutex->handle), INFINITE);
+#else
+  pthread_cond_wait (&(cond->handle), &(mutex->handle));
+#endif
+}
+
+void
+flott_cond_broadcast (flott_cond *cond)
+{
+#ifdef _MSC_VER
+  WakeAllConditionVariable (&(cond->handle));
+#else
+  pthread_cond_broadcast (&(cond->handle));
+#endif
+}
+
+void
+flott_cond_destroy (flott_cond *cond)
+{
+#ifdef _MSC_VER
+  (void) cond; ///< nothing to release
+#else
+  pthread_cond_destroy (&(cond->handle));
+#endif
+}
+
+/**
+ * number of online processors (at least one)
+ */
+size_t
+flott_get_cpu_count (void)
+{
+  size_t ret_val = 1;
+
+#ifdef _MSC_VER
+  SYSTEM_INFO info;
+  GetSystemInfo (&info);
+  ret_val = (size_t) info.dwNumberOfProcessors;
+#else
+  long count = sysconf (_SC_NPROCESSORS_ONLN);
+  if (count > 0) ret_val = (size_t) count;
+#endif
+
+  return (ret_val > 0) ? ret_val : 1;
+}
+
+/**
+ * reader thread: fill the two buffers in turn, each once the consumer has
+ * released it, until end of file or a stop request
+ */
+static void *
+flott_async_read_work (void *argument)
+{
+  flott_async_read *async = (flott_async_read *) argument;
+  size_t index = 0, length;
+
+  flott_mutex_lock (&(async->mutex));
+  while (async->stop == false)
+    {
+      while (async->full[index] == true && async->stop == false)
+        {
+          flott_cond_wait (&(async->cond), &(async->mutex));
+        }
+      if (async->stop == true) break;
+
+      flott_mutex_unlock (&(async->mutex));
+      length = fread (async->buffer + index * async->capacity, 1,
+                      async->capacity, async->handle);
+      flott_mutex_lock (&(async->mutex));
+
+      async->length[index] = length;
+      async->full[index] = true;
+      flott_cond_broadcast (&(async->cond));
+      if (length != async->capacity) break; ///< end of file
+      index ^= 1;
+    }
+  flott_mutex_unlock (&(async->mutex));
+
+  return NULL;
+}
+
+/**
+ * start reading 'handle' into 'buffer' (two buffers of 'capacity' bytes) in
+ * a reader thread of its own; if no thread can be started, the buffers are
+ * read by 'flott_async_read_next' instead
+ */
+void
+flott_async_read_open (flott_async_read *async, FILE *handle,
+                       char *buffer, size_t capacity)
+{
+  async->handle = handle;
+  async->buffer = buffer;
+  async->capacity = capacity;
+  async->length[0] = async->length[1] = 0;
+  async->full[0] = async->full[1] = false;
+  async->next = 0;
+  async->holding = false;
+  async->stop = false;
+  async->started = false;
+
+  if (flott_mutex_init (&(async->mutex)) == 0)
+    {
+      if (flott_cond_init (&(async->cond)) == 0)
+        {
+          async->started = (flott_thread_create (&(async->thread),
+                                                flott_async_read_work,
+                                                async) == 0);
+          if (async->started == false)
+            {
+              flott_cond_destroy (&(async->cond));
+            }
+        }
+      if (async->started == false)
+        {
+          flott_mutex_destroy (&(async->mutex));
+        }
+    }
+}
+
+/**
+ * release the buffer handed out last and wait for the next one, returns the
+ * number of bytes in '*data' (less than the capacity at end of file)
+ */
+size_t
+flott_async_read_next (flott_async_read *async, char **data)
+{
+  size_t index = async->next;
+  size_t length;
+
+  *data = async->buffer + index * async->capacity;
+  async->next ^= 1;
+  if (async->started == false)
+    {
+      return fread (*data, 1, async->capacity, async->handle);
+    }
+
+  flott_mutex_lock (&(async->mutex));
+  if (async->holding == true)
+    {
+      async->full[index ^ 1] = false;
+      flott_cond_broadcast (&(async->cond));
+    }
+  while (async->full[index] == false)
+    {
+      flott_cond_wait (&(async->cond), &(async->mutex));
+    }
+  async->holding = true;
+  length = async->length[index];
+  flott_mutex_unlock (&(async->mutex));
+
+  return length;
+}
+
+/**
+ * stop the reader thread and wait for it to exit; the stream is left open
+ */
+void
+flott_async_read_close (flott_async_read *async)
+{
+  if (async->started == true)
+    {
+      flott_mutex_lock (&(async->mutex));
+      async->stop = true;
+      flott_cond_broadcast (&(async->cond));
+      flott_mutex_unlock (&(async->mutex));
+
+      flott_thread_join (&(async->thread));
+      flott_cond_destroy (&(async->cond));
+      flott_mutex_destroy (&(async->mutex));
+      async->started = false;
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef _FLOTT_THREAD_H_
+#define _FLOTT_THREAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#include "flott_platform.h"
+
+#ifdef _MSC_VER
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
+/**
+ * constant 'define' macros
+ */
+#define FLOTT_MAX_THREADS 64 ///< upper limit of worker threads per object
+
+/**
+ * thin threading wrapper (pthreads, Win32 threads)
+ */
+typedef struct flott_thread flott_thread;
+typedef struct flott_mutex flott_mutex;
+typedef struct flott_cond flott_cond;
+typedef struct flott_async_read flott_async_read;
+typedef void *(flott_thread_routine) (void *);
+
+struct flott_thread
+{
+#ifdef _MSC_VER
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+  flott_thread_routine *routine; ///< thread entry point
+  void *argument;                ///< argument passed to 'routine'
+  void *result;                  ///< value returned by 'routine'
+};
+
+struct flott_mutex
+{
+#ifdef _MSC_VER
+  CRITICAL_SECTION handle;
+#else
+  pthread_mutex_t handle;
+#endif
+};
+
+struct flott_cond
+{
+#ifdef _MSC_VER
+  CONDITION_VARIABLE handle;
+#else
+  pthread_cond_t handle;
+#endif
+};
+
+/**
+ * double buffered file read-ahead: one reader thread per file fills the two
+ * buffers in turn and hands them over to the consumer, so that reading the
+ * next buffer overlaps processing the current one
+ */
+struct flott_async_read
+{
+  flott_thread thread;
+  flott_mutex mutex;
+  flott_cond cond;  ///< signals a buffer filled, released or a stop request
+  FILE *handle;     ///< stream to read from
+  char *buffer;     ///< two buffers of 'capacity' bytes each
+  size_t capacity;  ///< bytes per buffer
+  size_t length[2]; ///< bytes read into each buffer
+  bool full[2];     ///< buffer read and not yet released by the consumer
+  size_t next;      ///< buffer handed to the consumer next
+  bool holding;     ///< consumer holds the other buffer
+  bool stop;        ///< consumer asks the reader to quit
+  bool started;     ///< reader runs in 'thread' (else reads are synchronous)
+};
+
+int flott_thread_create (flott_thread *thread, flott_thread_routine *routine,
+                         void *argument);
+int flott_thread_join (flott_thread *thread);
+int flott_mutex_init (flott_mutex *mutex);
+void flott_mutex_lock (flott_mutex *mutex);
+void flott_mutex_unlock (flott_mutex *mutex);
+void flott_mutex_destroy (flott_mutex *mutex);
+int flott_cond_init (flott_cond *cond);
+void flott_cond_wait (flott_cond *cond, flott_mutex *mutex);
+void flott_cond_broadcast (flott_cond *cond);
+void flott_cond_destroy (flott_cond *cond);
+size_t flott_get_cpu_count (void);
+void flott_async_read_open (flott_async_read *async, FILE *handle,
+                            char *buffer, size_t capacity);
+size_t flott_async_read_next (flott_async_read *async, char **data);
+void flott_async_read_close (flott_async_read *async);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLOTT_THREAD_H_ */
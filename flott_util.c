@@ -16,22 +16,35 @@
  *
  */
 
+#ifdef _MSC_VER
+  #define _CRT_RAND_S ///< declares rand_s in stdlib.h
+#endif
+
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
 #include "flott_platform.h"
+#include "flott_util.h"
 
 #ifdef _MSC_VER
   #include <sys/types.h>
   /* stat is buggy in msvc 2008, use stat64 */
   #define stat _stat64
-  #ifndef S_ISREG
+  #ifndef S_ISREG
     #define S_ISREG(mode) (((mode) & _S_IFMT) == _S_IFREG)
   #endif
+  #ifndef S_ISDIR
+    #define S_ISDIR(mode) (((mode) & _S_IFMT) == _S_IFDIR)
+  #endif
+  #include <io.h>
 #else
   #include <unistd.h>  
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/file.h>
 #endif
 
 size_t
@@ -62,6 +75,24 @@ flott_file_exists (char *filename)
   return ret_val;
 }
 
+/**
+ * test for a readable path that is neither a regular file nor a directory,
+ * i.e. a pipe, fifo or character device that has to be read as a stream
+ */
+int
+flott_stream_exists (char *filename)
+{
+  int ret_val = 0;
+  struct stat info;
+  if ( stat (filename, &info) == 0
+       && !S_ISREG(info.st_mode) && !S_ISDIR(info.st_mode))
+    {
+      ret_val = 1;
+    }
+
+  return ret_val;
+}
+
 int
 flott_file_exists_not_empty (char *filename)
 {
@@ -76,7 +107,39 @@ flott_file_exists_not_empty (char *filename)
   return ret_val;
 }
 
-size_t flott_load_file_to_memory(const char *filename, char **result)
+/**
+ * heap allocation through 'allocator', or the C library if it is NULL
+ */
+void *
+flott_allocate (const flott_allocator *allocator, size_t size)
+{
+  return (allocator != NULL) ? allocator->allocate (allocator->user, size)
+                             : malloc (size);
+}
+
+void *
+flott_reallocate (const flott_allocator *allocator, void *data, size_t size)
+{
+  return (allocator != NULL)
+         ? allocator->reallocate (allocator->user, data, size)
+         : realloc (data, size);
+}
+
+void
+flott_deallocate (const flott_allocator *allocator, void *data)
+{
+  if (allocator != NULL)
+    {
+      if (data != NULL) allocator->deallocate (allocator->user, data);
+    }
+  else
+    {
+      free (data);
+    }
+}
+
+size_t flott_load_file_to_memory(const char *filename, char **result,
+                                 const flott_allocator *allocator)
 {
   size_t size = 0;
   FILE *fp = fopen (filename, "rb");
@@ -90,14 +153,15 @@ size_t flott_load_file_to_memory(const char *filename, char **result)
   size = ftell(fp);
 
   fseek (fp, 0, SEEK_SET);
-  *result = (char *) malloc (size + 1);
-  if (result != NULL)
+  *result = (char *) flott_allocate (allocator, size + 1);
+  if (*result != NULL)
     {
 
       if (size != fread (*result, sizeof (char), size, fp))
       {
-          free (*result);
+          flott_deallocate (allocator, *result);
           *result = NULL;
+          fclose (fp);
           return -2; /* -2 means file reading failed */
       }
     }
@@ -111,6 +175,530 @@ size_t flott_load_file_to_memory(const char *filename, char **result)
   return size;
 }
 
+/**
+ * read 'stream' until end of stream into a geometrically growing buffer
+ * (realloc, which remaps rather than copies large blocks on most systems);
+ * returns the number of bytes read, or (size_t) -1 if reading or an
+ * allocation failed
+ */
+size_t
+flott_load_stream_to_memory (FILE *stream, char **result,
+                             const flott_allocator *allocator)
+{
+  size_t size = 0;
+  size_t capacity = FLOTT_STREAM_CHUNK;
+  size_t read_bytes;
+  char *data = (char *) flott_allocate (allocator, capacity + 1);
+  char *grown;
+
+  *result = NULL;
+  if (data == NULL) return (size_t) -1;
+
+  while ((read_bytes = fread (data + size, 1, capacity - size, stream)) > 0)
+    {
+      size += read_bytes;
+      if (size == capacity)
+        {
+          grown = (capacity < SIZE_MAX / 2 - 1)
+                  ? (char *) flott_reallocate (allocator, data,
+                                              2 * capacity + 1) : NULL;
+          if (grown == NULL)
+            {
+              flott_deallocate (allocator, data);
+              return (size_t) -1;
+            }
+          data = grown;
+          capacity *= 2;
+        }
+    }
+
+  if (ferror (stream))
+    {
+      flott_deallocate (allocator, data);
+      return (size_t) -1;
+    }
+
+  /* give back the unused tail of the last doubling */
+  grown = (char *) flott_reallocate (allocator, data, size + 1);
+  *result = (grown != NULL) ? grown : data;
+
+  return size;
+}
+
+int
+flott_map_file (const char *filename, size_t length, char **result)
+{
+  int ret_val = 0;
+#ifdef _MSC_VER
+  HANDLE file, mapping;
+#else
+  void *data;
+  int fd;
+#endif
+  *result = NULL;
+
+  /* nothing to map for empty files */
+  if (length == 0) return ret_val;
+
+#ifdef _MSC_VER
+  file = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) return -1; /* -1 means opening failed */
+
+  mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle (file);
+  if (mapping == NULL) return -2; /* -2 means mapping failed */
+
+  *result = (char *) MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, length);
+  CloseHandle (mapping); ///< view keeps mapping alive
+  if (*result == NULL) ret_val = -2;
+#else
+  fd = open (filename, O_RDONLY);
+  if (fd < 0) return -1; /* -1 means opening failed */
+
+  data = mmap (NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd); ///< mapping keeps file referenced
+  if (data == MAP_FAILED)
+    {
+      ret_val = -2; /* -2 means mapping failed */
+    }
+  else
+    {
+      *result = (char *) data;
+    }
+#endif
+
+  return ret_val;
+}
+
+int
+flott_map_output_file (const char *filename, size_t length, char **result)
+{
+  int ret_val = 0;
+#ifdef _MSC_VER
+  HANDLE file, mapping;
+#else
+  void *data;
+  int fd;
+#endif
+  *result = NULL;
+
+#ifdef _MSC_VER
+  file = CreateFileA (filename, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                      CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return -1; /* -1 means opening failed */
+  if (length == 0)
+    {
+      CloseHandle (file); ///< nothing to map, leave empty file
+      return ret_val;
+    }
+
+  mapping = CreateFileMappingA (file, NULL, PAGE_READWRITE,
+                                (DWORD) ((uint64_t) length >> 32),
+                                (DWORD) (length & 0xffffffff), NULL);
+  CloseHandle (file);
+  if (mapping == NULL) return -2; /* -2 means mapping failed */
+
+  *result = (char *) MapViewOfFile (mapping, FILE_MAP_WRITE, 0, 0, length);
+  CloseHandle (mapping); ///< view keeps mapping alive
+  if (*result == NULL) ret_val = -2;
+#else
+  fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return -1; /* -1 means opening failed */
+  if (length == 0)
+    {
+      close (fd); ///< nothing to map, leave empty file
+      return ret_val;
+    }
+
+  /* sparse file, pages are only backed by disk once written */
+  if (ftruncate (fd, (off_t) length) != 0)
+    {
+      close (fd);
+      return -2;
+    }
+  data = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd); ///< mapping keeps file referenced
+  if (data == MAP_FAILED)
+    {
+      ret_val = -2; /* -2 means mapping failed */
+    }
+  else
+    {
+      *result = (char *) data;
+    }
+#endif
+
+  return ret_val;
+}
+
+int
+flott_resize_file (const char *filename, size_t length)
+{
+#ifdef _MSC_VER
+  int ret_val = 0;
+  LARGE_INTEGER size;
+  HANDLE file = CreateFileA (filename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return -1;
+
+  size.QuadPart = (LONGLONG) length;
+  if (!SetFilePointerEx (file, size, NULL, FILE_BEGIN) || !SetEndOfFile (file))
+    {
+      ret_val = -2;
+    }
+  CloseHandle (file);
+  return ret_val;
+#else
+  return (truncate (filename, (off_t) length) == 0) ? 0 : -2;
+#endif
+}
+
+void
+flott_advise_file (char *data, size_t length, flott_advice advice)
+{
+#ifndef _MSC_VER
+  if (data != NULL && length > 0)
+    {
+      madvise (data, length, (advice == FLOTT_ADVISE_SEQUENTIAL)
+                             ? MADV_SEQUENTIAL
+                             : (advice == FLOTT_ADVISE_WILLNEED)
+                               ? MADV_WILLNEED : MADV_RANDOM);
+    }
+#endif
+}
+
+/**
+ * access pattern hint for an entire file opened as 'handle'
+ */
+void
+flott_advise_handle (FILE *handle, flott_advice advice)
+{
+#if !defined(_MSC_VER) && defined(POSIX_FADV_SEQUENTIAL)
+  if (handle != NULL)
+    {
+      posix_fadvise (fileno (handle), 0, 0,
+                     (advice == FLOTT_ADVISE_SEQUENTIAL)
+                     ? POSIX_FADV_SEQUENTIAL
+                     : (advice == FLOTT_ADVISE_WILLNEED)
+                       ? POSIX_FADV_WILLNEED : POSIX_FADV_RANDOM);
+    }
+#endif
+}
+
+/**
+ * ask the OS to start reading 'filename' into the page cache, without
+ * waiting for it (no-op where not supported)
+ */
+void
+flott_prefetch_file (const char *filename)
+{
+#if !defined(_MSC_VER) && defined(POSIX_FADV_WILLNEED)
+  int fd = open (filename, O_RDONLY);
+  if (fd >= 0)
+    {
+      posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+      close (fd);
+    }
+#endif
+}
+
+void
+flott_unmap_file (char *data, size_t length)
+{
+  if (data != NULL && length > 0)
+    {
+#ifdef _MSC_VER
+      UnmapViewOfFile (data);
+#else
+      munmap (data, length);
+#endif
+    }
+}
+
+/**
+ * allocate a token workspace of 'size' bytes. Large workspaces are backed by
+ * 2 MB pages if possible (the transform chases offsets all over the
+ * workspace, so it is TLB-miss bound): explicit huge pages first, else a
+ * 2 MB aligned mapping advised to use transparent huge pages. Everything
+ * else gets cache line aligned heap memory. The backing obtained is stored
+ * in 'backing', as needed by 'flott_free_workspace'.
+ */
+void *
+flott_alloc_workspace (size_t size, flott_backing *backing)
+{
+  void *data = NULL;
+#if !defined(_MSC_VER) && defined(MAP_ANONYMOUS)
+  size_t length = (size + FLOTT_HUGE_PAGE_SIZE - 1)
+                  & ~((size_t) FLOTT_HUGE_PAGE_SIZE - 1);
+  char *mapping;
+  size_t head;
+
+  if (size >= FLOTT_HUGE_PAGE_MIN && length >= size)
+    {
+#ifdef MAP_HUGETLB
+      data = mmap (NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (data != MAP_FAILED)
+        {
+          *backing = FLOTT_BACKING_HUGETLB;
+          return data;
+        }
+#endif
+      /* over-allocate by a huge page and trim to a 2 MB aligned range */
+      mapping = (char *) mmap (NULL, length + FLOTT_HUGE_PAGE_SIZE,
+                               PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapping != (char *) MAP_FAILED)
+        {
+          head = (FLOTT_HUGE_PAGE_SIZE
+                  - ((size_t) mapping & (FLOTT_HUGE_PAGE_SIZE - 1)))
+                 & (FLOTT_HUGE_PAGE_SIZE - 1);
+          if (head > 0)
+            {
+              munmap (mapping, head);
+            }
+          munmap (mapping + head + length, FLOTT_HUGE_PAGE_SIZE - head);
+          data = mapping + head;
+
+          *backing = FLOTT_BACKING_PAGES;
+#ifdef MADV_HUGEPAGE
+          if (madvise (data, length, MADV_HUGEPAGE) == 0)
+            {
+              *backing = FLOTT_BACKING_THP;
+            }
+#endif
+          return data;
+        }
+      data = NULL;
+    }
+#endif
+
+#ifdef _MSC_VER
+  data = _aligned_malloc (size, FLOTT_CACHE_LINE);
+#else
+  if (posix_memalign (&data, FLOTT_CACHE_LINE, size) != 0)
+    {
+      data = NULL;
+    }
+#endif
+  *backing = (data != NULL) ? FLOTT_BACKING_HEAP : FLOTT_BACKING_NONE;
+
+  return data;
+}
+
+/**
+ * map a workspace of 'size' bytes onto an unlinked temporary file in
+ * 'directory', so that the OS pages the workspace to local storage instead of
+ * swap (out-of-core t-transform). Disk space is reserved up front, running out
+ * of it later would fault instead of failing here. The file name is built
+ * with 'allocator'. Returns NULL on failure.
+ */
+void *
+flott_map_scratch (const char *directory, size_t size,
+                   const flott_allocator *allocator)
+{
+  void *data = NULL;
+#if !defined(_MSC_VER)
+  char *filename;
+  int fd, error;
+
+  filename = (char *) flott_allocate (allocator, strlen (directory)
+                                                + sizeof ("/flott.XXXXXX"));
+  if (filename == NULL) return NULL;
+  sprintf (filename, "%s/flott.XXXXXX", directory);
+
+  fd = mkstemp (filename);
+  if (fd >= 0)
+    {
+      unlink (filename); ///< removed once unmapped, even on a crash
+      error = ENOSYS;
+#ifdef POSIX_FADV_WILLNEED /* posix_fadvise implies posix_fallocate */
+      error = posix_fallocate (fd, 0, (off_t) size);
+#endif
+      if (error == ENOSYS || error == EINVAL || error == EOPNOTSUPP)
+        {
+          /* no reservation on this file system, use a sparse file */
+          error = (ftruncate (fd, (off_t) size) == 0) ? 0 : errno;
+        }
+      if (error == 0)
+        {
+          data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+          if (data == MAP_FAILED)
+            {
+              data = NULL;
+            }
+        }
+      close (fd); ///< mapping keeps file referenced
+    }
+  flott_deallocate (allocator, filename);
+#endif
+
+  return data;
+}
+
+/**
+ * physical memory size in bytes (0 if unknown)
+ */
+size_t
+flott_get_memory_size (void)
+{
+#ifdef _MSC_VER
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof (status);
+  return GlobalMemoryStatusEx (&status) ? (size_t) status.ullTotalPhys : 0;
+#else
+  long pages = sysconf (_SC_PHYS_PAGES);
+  long page_size = sysconf (_SC_PAGESIZE);
+  return (pages > 0 && page_size > 0) ? (size_t) pages * (size_t) page_size
+                                      : 0;
+#endif
+}
+
+/**
+ * hand the pages of mapping range 'data' (page aligned) back to the OS; the
+ * contents are dropped, i.e. dirty scratch pages are never written back
+ */
+void
+flott_discard_pages (char *data, size_t length)
+{
+#ifndef _MSC_VER
+  if (data != NULL && length > 0)
+    {
+#ifdef MADV_REMOVE
+      if (madvise (data, length, MADV_REMOVE) == 0) return;
+#endif
+      madvise (data, length, MADV_DONTNEED);
+    }
+#endif
+}
+
+void
+flott_free_workspace (void *data, size_t size, flott_backing backing)
+{
+  if (data == NULL) return;
+
+  switch (backing)
+    {
+#ifndef _MSC_VER
+      case FLOTT_BACKING_HUGETLB :
+      case FLOTT_BACKING_THP :
+      case FLOTT_BACKING_PAGES :
+        munmap (data, (size + FLOTT_HUGE_PAGE_SIZE - 1)
+                      & ~((size_t) FLOTT_HUGE_PAGE_SIZE - 1));
+        break;
+      case FLOTT_BACKING_SCRATCH :
+        munmap (data, size);
+        break;
+#endif
+      case FLOTT_BACKING_HEAP :
+#ifdef _MSC_VER
+        _aligned_free (data);
+#else
+        free (data);
+#endif
+        break;
+      default : break; ///< borrowed memory is never freed
+    }
+}
+
+/**
+ * open (create) 'filename' and take an advisory lock on it, shared or
+ * 'exclusive'; blocks until the lock is granted. Returns the locked handle,
+ * or NULL on failure. Released by 'flott_unlock_file'.
+ */
+FILE *
+flott_lock_file (const char *filename, bool exclusive)
+{
+  FILE *handle = fopen (filename, "ab");
+  int locked;
+
+  if (handle == NULL) return NULL;
+#ifdef _MSC_VER
+  {
+    OVERLAPPED overlapped;
+
+    memset (&overlapped, 0, sizeof (overlapped));
+    locked = LockFileEx ((HANDLE) _get_osfhandle (_fileno (handle)),
+                         exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0,
+                         MAXDWORD, MAXDWORD, &overlapped);
+  }
+#else
+  do
+    {
+      locked = (flock (fileno (handle), exclusive ? LOCK_EX : LOCK_SH) == 0);
+    }
+  while (!locked && errno == EINTR);
+#endif
+  if (!locked)
+    {
+      fclose (handle);
+      handle = NULL;
+    }
+
+  return handle;
+}
+
+void
+flott_unlock_file (FILE *handle)
+{
+  if (handle == NULL) return;
+#ifdef _MSC_VER
+  {
+    OVERLAPPED overlapped;
+
+    memset (&overlapped, 0, sizeof (overlapped));
+    UnlockFileEx ((HANDLE) _get_osfhandle (_fileno (handle)), 0, MAXDWORD,
+                  MAXDWORD, &overlapped);
+  }
+#else
+  flock (fileno (handle), LOCK_UN);
+#endif
+  fclose (handle);
+}
+
+/**
+ * atomically replace file 'to' by file 'from' (readers see either the old or
+ * the new file, never a partial one); returns 0 on success
+ */
+int
+flott_replace_file (const char *from, const char *to)
+{
+#ifdef _MSC_VER
+  return MoveFileExA (from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+  return rename (from, to);
+#endif
+}
+
+/**
+ * fill 'data' with 'length' bytes from the system's random source; returns 0
+ * on success
+ */
+int
+flott_random_bytes (void *data, size_t length)
+{
+#ifdef _MSC_VER
+  unsigned int value;
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    {
+      if (rand_s (&value) != 0) return -1;
+      ((unsigned char *) data)[i] = (unsigned char) value;
+    }
+  return 0;
+#else
+  FILE *handle = fopen ("/dev/urandom", "rb");
+  size_t count;
+
+  if (handle == NULL) return -1;
+  count = fread (data, 1, length, handle);
+  fclose (handle);
+  return (count == length) ? 0 : -1;
+#endif
+}
+
 int
 flott_get_digit_count (uint64_t uint_val)
 {
@@ -23,12 +23,92 @@
 extern "C" {
 #endif
 
+#include <stdio.h>
+
 #include "flott_platform.h"
 
+#define FLOTT_STREAM_CHUNK (1 << 16) ///< initial stream buffer size in bytes
+#define FLOTT_CACHE_LINE 64              ///< workspace alignment in bytes
+#define FLOTT_HUGE_PAGE_SIZE (1 << 21)   ///< 2 MB huge pages
+#define FLOTT_HUGE_PAGE_MIN (1 << 23)    ///< min. workspace size for huge pages
+#define FLOTT_SCRATCH_STEP (1 << 24)     ///< out-of-core release/prefetch step
+
+/**
+ * custom heap allocator (e.g. the pool or arena of a long-running service);
+ * each function gets 'user' as its first argument and has to be thread-safe
+ * when worker threads are used (batch, matrix, parallel nti distance)
+ */
+typedef struct flott_allocator flott_allocator;
+typedef void *(flott_allocate_handler) (void *, size_t);
+typedef void *(flott_reallocate_handler) (void *, void *, size_t);
+typedef void (flott_deallocate_handler) (void *, void *);
+
+struct flott_allocator
+{
+  flott_allocate_handler *allocate;     ///< allocate (user, size)
+  flott_reallocate_handler *reallocate; ///< resize (user, pointer, size)
+  flott_deallocate_handler *deallocate; ///< release (user, pointer)
+  void *user;                           ///< allocator state
+};
+
+/**
+ * memory backing of a token workspace (in order of preference)
+ */
+typedef enum flott_backing flott_backing;
+
+enum flott_backing
+{
+  FLOTT_BACKING_NONE     = 0, ///< no workspace
+  FLOTT_BACKING_HUGETLB  = 1, ///< explicit 2 MB huge pages (MAP_HUGETLB)
+  FLOTT_BACKING_THP      = 2, ///< transparent huge pages (MADV_HUGEPAGE)
+  FLOTT_BACKING_PAGES    = 3, ///< anonymous mapping, regular pages
+  FLOTT_BACKING_HEAP     = 4, ///< cache line aligned heap memory
+  FLOTT_BACKING_BORROWED = 5, ///< caller supplied memory
+  FLOTT_BACKING_ALLOCATOR = 6, ///< custom allocator ('flott_allocator')
+  FLOTT_BACKING_SCRATCH  = 7  ///< file mapping on scratch storage (out-of-core)
+};
+
+/**
+ * memory access pattern hints for memory mapped files
+ */
+typedef enum flott_advice flott_advice;
+
+enum flott_advice
+{
+  FLOTT_ADVISE_SEQUENTIAL = 1, ///< read ahead aggressively (level-zero init)
+  FLOTT_ADVISE_RANDOM     = 2, ///< no read ahead (copy pattern output)
+  FLOTT_ADVISE_WILLNEED   = 3  ///< start reading ahead now (next input)
+};
+
 int flott_file_exists (char *filename);
-int flott_get_file_size (char *filename);
+size_t flott_get_file_size (char *filename);
 int flott_file_exists_not_empty (char *filename);
-int flott_load_file_to_memory(const char *filename, char **result);
+int flott_stream_exists (char *filename);
+size_t flott_load_file_to_memory(const char *filename, char **result,
+                                 const flott_allocator *allocator);
+size_t flott_load_stream_to_memory (FILE *stream, char **result,
+                                    const flott_allocator *allocator);
+int flott_map_file (const char *filename, size_t length, char **result);
+int flott_map_output_file (const char *filename, size_t length, char **result);
+int flott_resize_file (const char *filename, size_t length);
+void flott_advise_file (char *data, size_t length, flott_advice advice);
+void flott_advise_handle (FILE *handle, flott_advice advice);
+void flott_prefetch_file (const char *filename);
+void flott_unmap_file (char *data, size_t length);
+void *flott_allocate (const flott_allocator *allocator, size_t size);
+void *flott_reallocate (const flott_allocator *allocator, void *data,
+                        size_t size);
+void flott_deallocate (const flott_allocator *allocator, void *data);
+void *flott_alloc_workspace (size_t size, flott_backing *backing);
+void *flott_map_scratch (const char *directory, size_t size,
+                         const flott_allocator *allocator);
+size_t flott_get_memory_size (void);
+void flott_discard_pages (char *data, size_t length);
+void flott_free_workspace (void *data, size_t size, flott_backing backing);
+FILE *flott_lock_file (const char *filename, bool exclusive);
+void flott_unlock_file (FILE *handle);
+int flott_replace_file (const char *from, const char *to);
+int flott_random_bytes (void *data, size_t length);
 int flott_get_digit_count (uint64_t uint_val);
 
 #ifdef __cplusplus
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "flott.h"
+#include "flott_window.h"
+#include "flott_util.h"
+
+/**
+ * external prototype definitions
+ */
+extern void flott_t_transform_simple (flott_object *op);
+
+/**
+ * make sure input sources can be read window by window: load or map files
+ * that are meant to be memory resident and open streamed files; sources
+ * this call opens are flagged in 'opened' (one entry per input source)
+ */
+static int
+flott_window_open_sources (flott_object *op, size_t *input_length,
+                           char *opened)
+{
+  int ret_val = FLOTT_SUCCESS;
+  flott_source *source;
+  size_t i;
+
+  *input_length = 0;
+  if ((ret_val = flott_load_streams (op)) != FLOTT_SUCCESS)
+    {
+      return ret_val;
+    }
+  for (i = 0; i < op->input.sequence.length && ret_val == FLOTT_SUCCESS; i++)
+    {
+      if (op->input.sequence.member[i] >= op->input.count)
+        {
+          return flott_set_status (op, FLOTT_ERR_INDEX_BOUNDS, FLOTT_VL_FATAL,
+                                   " (sequence index)");
+        }
+      source = &(op->input.source[op->input.sequence.member[i]]);
+      *input_length += source->length;
+
+      switch (source->storage_type)
+        {
+          case FLOTT_DEV_MEM :
+          case FLOTT_DEV_DEALLOC_MEM :
+            if (source->data.bytes == NULL && source->length > 0)
+              {
+                ret_val = flott_set_status (op, FLOTT_ERR_NULL_POINTER,
+                                            FLOTT_VL_FATAL);
+              }
+            break;
+          case FLOTT_DEV_FILE_TO_MEM :
+            if (source->data.bytes != NULL
+                || opened[op->input.sequence.member[i]])
+              {
+                break;  ///< already loaded (or listed twice in the sequence)
+              }
+            if (flott_load_file_to_memory (source->path, &(source->data.bytes),
+                                           op->allocator)
+                != source->length)
+              {
+                flott_deallocate (op->allocator, source->data.bytes);
+                source->data.bytes = NULL;
+                ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                            FLOTT_VL_FATAL, source->path);
+                break;
+              }
+            opened[op->input.sequence.member[i]] = true;
+            break;
+          case FLOTT_DEV_MMAP :
+            if (source->data.bytes == NULL)
+              {
+                if (flott_map_file (source->path, source->length,
+                                    &(source->data.bytes)) != 0)
+                  {
+                    ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                                FLOTT_VL_FATAL, source->path);
+                    break;
+                  }
+                opened[op->input.sequence.member[i]] = true;
+              }
+            flott_advise_file (source->data.bytes, source->length,
+                               FLOTT_ADVISE_SEQUENTIAL);
+            break;
+          case FLOTT_DEV_FILE :
+            if (source->data.handle == NULL)
+              {
+                source->data.handle = fopen (source->path, "rb");
+                if (source->data.handle == NULL)
+                  {
+                    ret_val = flott_set_status (op, FLOTT_ERR_LOADING_FILE,
+                                                FLOTT_VL_FATAL, source->path);
+                    break;
+                  }
+                opened[op->input.sequence.member[i]] = true;
+              }
+            break;
+          case FLOTT_DEV_CALLBACK :
+            if (source->data.reader == NULL
+                || source->data.reader->pread == NULL)
+              {
+                ret_val = flott_set_status (op, FLOTT_ERR_WINDOW,
+                                            FLOTT_VL_FATAL,
+                                            " (callback source without pread)");
+              }
+            break;
+          default : /* stop symbols have no byte representation */
+            ret_val = flott_set_status (op, FLOTT_ERR_WINDOW, FLOTT_VL_FATAL,
+                                        " (unsupported input source)");
+            break;
+        }
+    }
+
+  return ret_val;
+}
+
+/**
+ * release the sources flagged in 'opened' by 'flott_window_open_sources'
+ */
+static void
+flott_window_close_sources (flott_object *op, char *opened)
+{
+  flott_source *source;
+  size_t i;
+
+  for (i = 0; i < op->input.count; i++)
+    {
+      if (opened[i] == false) continue;
+      source = &(op->input.source[i]);
+      switch (source->storage_type)
+        {
+          case FLOTT_DEV_FILE_TO_MEM :
+            flott_deallocate (op->allocator, source->data.bytes);
+            source->data.bytes = NULL;
+            break;
+          case FLOTT_DEV_MMAP :
+            flott_unmap_file (source->data.bytes, source->length);
+            source->data.bytes = NULL;
+            break;
+          case FLOTT_DEV_FILE :
+            fclose (source->data.handle);
+            source->data.handle = NULL;
+            break;
+          default :
+            break;
+        }
+      opened[i] = false;
+    }
+}
+
+/**
+ * get a pointer to 'length' bytes of the input sequence starting at 'offset';
+ * windows within a single memory resident source are not copied, otherwise
+ * the window is assembled in 'buffer'
+ */
+static char *
+flott_window_fetch (flott_object *op, size_t offset, size_t length,
+                    char *buffer)
+{
+  flott_source *source;
+  size_t i, count;
+  char *data = buffer;
+
+  for (i = 0; i < op->input.sequence.length && length > 0; i++)
+    {
+      source = &(op->input.source[op->input.sequence.member[i]]);
+      if (offset >= source->length)
+        {
+          offset -= source->length;
+          continue;
+        }
+
+      count = flott_min_M (length, source->length - offset);
+      if (source->storage_type == FLOTT_DEV_FILE)
+        {
+          fseek (source->data.handle, (long) offset, SEEK_SET);
+          if (fread (data, 1, count, source->data.handle) != count)
+            {
+              return NULL;
+            }
+        }
+      else if (source->storage_type == FLOTT_DEV_CALLBACK)
+        {
+          if (source->data.reader->pread (source->user, data, count, offset)
+              != count)
+            {
+              return NULL;
+            }
+        }
+      else if (data == buffer && count == length)
+        {
+          return &(source->data.bytes[offset]); ///< zero-copy window
+        }
+      else
+        {
+          memcpy (data, &(source->data.bytes[offset]), count);
+        }
+
+      data += count;
+      length -= count;
+      offset = 0;
+    }
+
+  return (length == 0) ? buffer : NULL;
+}
+
+/**
+ * t-transform a sliding window over the (concatenated) input sequence.
+ *
+ * Windows of 'op->window.size' bytes start every 'op->window.stride' bytes
+ * (non-overlapping if the stride is 0); input shorter than a window is
+ * processed as a single window, a trailing partial window is not. The
+ * result of each window is handed to 'op->handler.window' together with the
+ * window's start offset; the handler may terminate early. All windows are
+ * t-transformed in the same workspace, which is sized for one window (i.e.
+ * the 16-bit engine is used for windows of up to 64K symbols).
+ *
+ * Each window is initialized and t-transformed from scratch: the
+ * t-decomposition of a window is not an update of its predecessor's, as
+ * adding or dropping a single symbol can change every copy pattern. Overlap
+ * only saves the workspace allocation and, for windows within a memory
+ * resident source, the copy of the window bytes. The cost is therefore
+ * proportional to 'size' times the number of windows, as with separate runs.
+ *
+ * Files opened, loaded or mapped here are released before returning.
+ */
+int
+flott_t_transform_window (flott_object *op)
+{
+  int ret_val = FLOTT_SUCCESS;
+  int terminate = false;
+  flott_object window_op;
+  flott_source source;
+  size_t member = 0;
+  size_t input_length, window_size, stride, offset;
+  char *buffer, *opened;
+
+  if (op == NULL || op->input.source == NULL)
+    {
+      return FLOTT_ERR_INVALID_OBJ;
+    }
+
+  /* default sequence: all sources, concatenated left-to-right */
+  if (op->input.sequence.length == 0)
+    {
+      op->input.sequence.deallocate = true; ///< auto deallocation
+      op->input.sequence.member =
+          (size_t *) flott_allocate (op->allocator,
+                                     op->input.count * sizeof (size_t));
+      if (op->input.sequence.member == NULL)
+        {
+          return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT,
+                                   FLOTT_VL_FATAL, " (sequence list)");
+        }
+      op->input.sequence.length = op->input.count;
+      for (member = 0; member < op->input.count; member++)
+        {
+          op->input.sequence.member[member] = member;
+        }
+      member = 0;
+    }
+
+  if (op->window.size == 0)
+    {
+      return flott_set_status (op, FLOTT_ERR_WINDOW, FLOTT_VL_FATAL,
+                               " (window size is zero)");
+    }
+
+  opened = (char *) flott_allocate (op->allocator, op->input.count + 1);
+  if (opened == NULL)
+    {
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (window sources)");
+    }
+  memset (opened, false, op->input.count + 1);
+
+  if ((ret_val = flott_window_open_sources (op, &input_length, opened))
+      != FLOTT_SUCCESS)
+    {
+      flott_window_close_sources (op, opened);
+      flott_deallocate (op->allocator, opened);
+      return ret_val;
+    }
+
+  window_size = flott_min_M (op->window.size, input_length);
+  stride = (op->window.stride > 0) ? op->window.stride : op->window.size;
+
+  /* set up a single source object on the stack */
+  memset (&window_op, 0, sizeof (flott_object));
+  memset (&source, 0, sizeof (flott_source));
+  window_op.input.symbol_type = op->input.symbol_type;
+  window_op.input.append_termchar = op->input.append_termchar;
+  window_op.verbosity_level = op->verbosity_level;
+  window_op.handler.error = op->handler.error;
+  window_op.handler.message = op->handler.message;
+  window_op.user = op->user;
+  window_op.allocator = op->allocator;
+  window_op.scratch = op->scratch;
+
+  source.storage_type = FLOTT_DEV_MEM;
+  source.length = window_size;
+  window_op.input.count = 1;
+  window_op.input.source = &source;
+  window_op.input.sequence.length = 1;
+  window_op.input.sequence.member = &member;
+
+  buffer = (char *) flott_allocate (op->allocator, window_size + 1);
+  if (buffer == NULL)
+    {
+      flott_window_close_sources (op, opened);
+      flott_deallocate (op->allocator, opened);
+      return flott_set_status (op, FLOTT_ERR_MALLOC_FLOTT, FLOTT_VL_FATAL,
+                               " (window buffer)");
+    }
+
+  /* if set, call user initialization callback function */
+  op->_private.ln2 = log (2.0);
+  op->input.length = input_length;
+  if (op->handler.init != NULL)
+    {
+      ret_val = op->handler.init (op);
+    }
+
+  for (offset = 0; ret_val == FLOTT_SUCCESS && terminate == false
+                   && offset + window_size <= input_length; offset += stride)
+    {
+      source.data.bytes = flott_window_fetch (op, offset, window_size, buffer);
+      if (source.data.bytes == NULL)
+        {
+          ret_val = flott_set_status (op, FLOTT_ERR_WINDOW, FLOTT_VL_FATAL,
+                                      " (reading input failed)");
+          break;
+        }
+
+      /* the workspace allocated for the first window is reused */
+      if ((ret_val = flott_initialize (&window_op)) != FLOTT_SUCCESS)
+        {
+          op->status = window_op.status;
+          break;
+        }
+      flott_t_transform_simple (&window_op);
+
+      if (op->handler.window != NULL)
+        {
+          op->handler.window (op, offset, &(window_op.result), &terminate);
+        }
+      op->result = window_op.result;
+    }
+
+  flott_deinitialize (&window_op);
+  flott_deallocate (op->allocator, buffer);
+  flott_window_close_sources (op, opened);
+  flott_deallocate (op->allocator, opened);
+
+  return ret_val;
+}
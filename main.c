@@ -21,11 +21,14 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <limits.h>
+#include <ctype.h>
 
 #include "flott.h"
 #include "flott_term.h"
 #include "flott_output.h"
 #include "flott_util.h"
+#include "flott_thread.h"
 
 void
 help (void)
@@ -35,7 +38,7 @@ help (void)
 
 int
 set_input_sources (flott_object* op, char** argv, int argc,
-                   bool buffer_input_flag)
+                   flott_storage_type file_storage_type)
 {
   int ret_val = FLOTT_SUCCESS;
 
@@ -47,7 +50,7 @@ set_input_sources (flott_object* op, char** argv, int argc,
   options.opterr = 0;
 
   op->input.source =
-      (flott_source *) malloc (sizeof (flott_source) * (op->input.count));
+      (flott_source *) calloc (op->input.count, sizeof (flott_source));
 
   if (op->input.source != NULL)
     {
@@ -65,6 +68,7 @@ set_input_sources (flott_object* op, char** argv, int argc,
                       source = &(op->input.source[input_count++]);
                       source->storage_type = FLOTT_DEV_MEM;
                       source->length = strlen(options.optarg);
+                      source->path = NULL;
                       source->data.bytes = options.optarg;
                     }
                   else
@@ -80,13 +84,26 @@ set_input_sources (flott_object* op, char** argv, int argc,
                       && flott_file_exists (options.optarg))
                     {
                       source = &(op->input.source[input_count++]);
-                      source->storage_type = FLOTT_DEV_FILE;
-                      if (buffer_input_flag == true)
-                        {
-                          source->storage_type = FLOTT_DEV_FILE_TO_MEM;
-                        }
+                      source->storage_type = file_storage_type;
                       source->length = flott_get_file_size(options.optarg);
                       source->path = options.optarg;
+                      source->data.bytes = NULL;
+                    }
+                  else if (options.optarg != NULL
+                           && (strcmp (options.optarg, "-") == 0
+                               || flott_stream_exists (options.optarg)))
+                    {
+                      /* stdin, pipe or fifo: length known after reading */
+                      source = &(op->input.source[input_count++]);
+                      source->storage_type = FLOTT_DEV_STREAM;
+                      source->length = 0;
+                      source->path = NULL;
+                      source->data.handle = stdin;
+                      if (strcmp (options.optarg, "-") != 0)
+                        {
+                          source->path = options.optarg;
+                          source->data.handle = NULL;
+                        }
                     }
                   else
                     {
@@ -157,6 +174,14 @@ set_column_format (flott_output_options *options, char* optarg)
     {
       *options |= FLOTT_OUT_CSV;
     }
+  else if (optarg != NULL && strncmp("=phylip", optarg, 7) == 0)
+    {
+      *options |= FLOTT_OUT_PHYLIP;
+    }
+  else if (optarg != NULL && strncmp("=bin", optarg, 4) == 0)
+    {
+      *options |= FLOTT_OUT_BINARY;
+    }
   else
     {
       *options |= FLOTT_OUT_PRETTY;
@@ -185,11 +210,11 @@ int parse_command_line (flott_object *op,
   int input_count = 0;
   int letter;
   bool quiet_flag = false;
-  bool buffer_input_flag = false;
+  flott_storage_type file_storage_type = FLOTT_DEV_FILE;
   flott_getopt_object options;
 
   /* set allowed command line switches and parse input arguments */
-  flott_init_options (&options, "-hqv:dDcierxnkpolI:S:b:jzmo:O:F:u:g:L",
+  flott_init_options (&options, "-hqv:dDacierx::nkpolI:S:b:jzmMT::W:w:s:o:O:C:P:F:u:g:L",
                       argv, argc);
 
   /* parse and process command line arguments */
@@ -222,7 +247,9 @@ int parse_command_line (flott_object *op,
                    break;
          case 'I': {
                      if (options.optarg != NULL
-                         && flott_file_exists (options.optarg))
+                         && (flott_file_exists (options.optarg)
+                             || strcmp (options.optarg, "-") == 0
+                             || flott_stream_exists (options.optarg)))
                        {
                          input_count++;
                        }
@@ -233,6 +260,8 @@ int parse_command_line (flott_object *op,
          case 'D': output->options |= FLOTT_OUT_NTC_DIST;
                    op->input.append_termchar = true;
                    break;
+         case 'a': output->options |= FLOTT_OUT_MATRIX;
+                   break;
          case 'c': output->options |= FLOTT_OUT_T_COMPLEXITY;
                    break;
          case 'i': output->options |= FLOTT_OUT_T_INFORMATION;
@@ -241,7 +270,24 @@ int parse_command_line (flott_object *op,
                    break;
          case 'r': output->options |= FLOTT_OUT_INST_T_ENTROPY;
                    break;
-         case 'x': output->options |= FLOTT_OUT_INPUT_OFFSET;
+         case 'x': {
+                     output->options |= FLOTT_OUT_INPUT_OFFSET;
+                     if (options.optarg != NULL && (*options.optarg == '='
+                         || isdigit ((unsigned char) *options.optarg)))
+                       {
+                         output->bin_size = (size_t) set_int_argument (
+                             options.optarg + (*options.optarg == '='),
+                             1, INT_MAX, 0);
+                       }
+                     else if (options.optarg != NULL
+                              && options.optarg != argv[options.optind - 1])
+                       {
+                         /* not a bin size, parse as concatenated switches */
+                         options.optind--;
+                         options.optoff = (int) (options.optarg
+                                                 - argv[options.optind]);
+                       }
+                   }
                    break;
          case 'n': output->options |= FLOTT_OUT_T_AUG_LEVEL;
                    break;
@@ -259,13 +305,43 @@ int parse_command_line (flott_object *op,
                    break;
          case 'z': op->input.append_termchar = true;
                    break;
-         case 'm': buffer_input_flag = true;
+         case 'm': file_storage_type = FLOTT_DEV_FILE_TO_MEM;
+                   break;
+         case 'M': file_storage_type = FLOTT_DEV_MMAP;
+                   break;
+         case 'w': op->window.size = set_int_argument (options.optarg, 1,
+                                                       INT_MAX, 0);
+                   break;
+         case 's': op->window.stride = set_int_argument (options.optarg, 1,
+                                                         INT_MAX, 0);
+                   break;
+         case 'T': {
+                     /* bare '-T' uses all cores */
+                     const char *count = options.optarg;
+
+                     if (count != NULL && *count == '=') count++;
+                     op->thread_count = set_int_argument (count, 1,
+                         FLOTT_MAX_THREADS, (int) flott_get_cpu_count ());
+                   }
+                   break;
+         case 'W': {
+                     /* workspaces that fit into memory are faster there */
+                     op->scratch.path = options.optarg;
+                     op->scratch.threshold = flott_get_memory_size () / 2;
+                   }
                    break;
          case 'O': {
                      output->storage_type = FLOTT_DEV_FILE;
                      output->path = options.optarg;
                    }
                    break;
+         case 'C': output->cache_path = options.optarg;
+                   break;
+         case 'P': {
+                     output->options |= FLOTT_OUT_CONCAT_INPUT;
+                     output->profile_path = options.optarg;
+                   }
+                   break;
          case 'F': set_column_format (&(output->options), options.optarg);
                    break;
          case 'u': set_output_units (&(output->options), options.optarg);
@@ -303,21 +379,34 @@ int parse_command_line (flott_object *op,
       output->options &= ~FLOTT_OUT_CP_STRING;
     }
 
+  /* sliding window output: one line per window, labeled with its offset */
+  if (op->window.size > 0)
+    {
+      output->options |= FLOTT_OUT_INPUT_OFFSET;
+      output->options &= ~(FLOTT_OUT_CF | FLOTT_OUT_CP_OFFSET
+                           | FLOTT_OUT_CP_LENGTH | FLOTT_OUT_CP_STRING
+                           | FLOTT_OUT_INST_T_ENTROPY);
+    }
+
   /* now that we know how many inputs we have, load all input data */
   if (ret_val == FLOTT_SUCCESS)
     {
       if (input_count == 1) output->options |= FLOTT_OUT_CONCAT_INPUT;
-      if (flott_bitset_M (output->options, FLOTT_OUT_NTC_DIST))
+      if (flott_bitset_M (output->options, FLOTT_OUT_NTC_DIST)
+          && !flott_bitset_M (output->options, FLOTT_OUT_MATRIX))
       {
         input_count++;
       }
       op->input.count = input_count;
 
-      ret_val = set_input_sources (op, argv, argc, buffer_input_flag);
+      ret_val = set_input_sources (op, argv, argc, file_storage_type);
       if (ret_val != FLOTT_SUCCESS)
         {
           return ret_val;
         }
+
+      /* read streams now, output setup needs every input length */
+      ret_val = flott_load_streams (op);
     }
 
   return ret_val;
@@ -361,7 +450,10 @@ main (int argc, char *argv[])
 
       /* set custom user defined callback handlers for user functions */
       op->handler.init = &flott_output_initialize;
-      op->handler.step = &flott_output_step;
+      op->handler.record = &flott_output_records;
+      op->step_buffer.record = output.records;
+      op->step_buffer.size = FLOTT_OUT_RECORD_BUFSZ;
+      op->handler.window = &flott_output_window;
       op->handler.destroy = &flott_output_destroy;
 
       if(op->verbosity_level != FLOTT_VL_QUIET)
@@ -377,8 +469,26 @@ main (int argc, char *argv[])
           return ret_val;
         }
 
+      /* open persistent result cache */
+      if (output.cache_path != NULL
+          && (ret_val = flott_cache_open (output.cache_path, 0, op->allocator,
+                                          &(op->cache)))
+             != FLOTT_SUCCESS)
+        {
+          ret_val = flott_set_status (op, ret_val, FLOTT_VL_FATAL,
+                                      " (result cache)");
+          flott_destroy (op);
+          return ret_val;
+        }
+
+      /* all-pairs distance matrix */
+      if (flott_bitset_M (output.options, FLOTT_OUT_MATRIX)
+          && (output.options & (FLOTT_OUT_NTI_DIST | FLOTT_OUT_NTC_DIST)))
+        {
+          ret_val = flott_output_matrix (op);
+        }
       /* normalized t-information distance */
-      if (flott_bitset_M (output.options, FLOTT_OUT_NTI_DIST))
+      else if (flott_bitset_M (output.options, FLOTT_OUT_NTI_DIST))
         {
           ret_val = flott_output_nti_dist (op);
         }
@@ -391,6 +501,15 @@ main (int argc, char *argv[])
           ret_val = flott_output (op);
         }
 
+      /* write back result cache */
+      if (op->cache != NULL && flott_cache_close (op->cache) != FLOTT_SUCCESS
+          && ret_val == FLOTT_SUCCESS)
+        {
+          ret_val = flott_set_status (op, FLOTT_ERR_WRITING_FILE,
+                                      FLOTT_VL_FATAL, " (result cache)");
+        }
+      op->cache = NULL;
+
       /* clean up */
       flott_destroy (op);
     }
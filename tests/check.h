@@ -0,0 +1,78 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * shared helpers of the 'make check' drivers (header only, one driver per
+ * executable): assertions and reports; test inputs come from 'fixture.h'
+ */
+
+#ifndef _FLOTT_CHECK_H_
+#define _FLOTT_CHECK_H_
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../flott.h"
+#include "../flott_util.h"
+#include "fixture.h"
+
+static int check_failures_G = 0;
+
+#define check_M(condition, ...) \
+  do \
+    { \
+      if (!(condition)) \
+        { \
+          check_failures_G++; \
+          fprintf (stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+          fprintf (stderr, __VA_ARGS__); \
+          fprintf (stderr, "\n"); \
+        } \
+    } \
+  while (0)
+
+/**
+ * lowest free file descriptor, to spot handles left open
+ */
+static inline int
+check_free_descriptor (void)
+{
+  int fd = open ("/dev/null", O_RDONLY);
+
+  close (fd);
+  return fd;
+}
+
+static inline int
+check_report (const char *name)
+{
+  if (check_failures_G == 0)
+    {
+      printf ("ok   %s\n", name);
+    }
+  else
+    {
+      printf ("FAIL %s (%d failures)\n", name, check_failures_G);
+    }
+  return (check_failures_G == 0) ? 0 : 1;
+}
+
+#endif /* _FLOTT_CHECK_H_ */
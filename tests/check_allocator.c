@@ -0,0 +1,254 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * allocator hooks: one object with a counting allocator and a reserved
+ * 'flott_workspace' transforms a stream of inputs with no allocations after
+ * the first, also with parallel level-zero initialization; out-of-core
+ * workspaces build their file name with the allocator as well; every
+ * allocation is released again and the results match objects on the C
+ * library and their own workspaces
+ */
+
+#include <math.h>
+
+#include "check.h"
+
+#define CHECK_INPUTS 200
+#define CHECK_MAX_LENGTH 65536
+
+typedef struct check_counter check_counter;
+
+struct check_counter
+{
+  size_t allocations;     ///< allocate and reallocate calls
+  size_t deallocations;   ///< deallocate calls
+};
+
+static void *
+check_allocate (void *user, size_t size)
+{
+  ((check_counter *) user)->allocations++;
+  return malloc (size);
+}
+
+static void *
+check_reallocate (void *user, void *data, size_t size)
+{
+  ((check_counter *) user)->allocations++;
+  ((check_counter *) user)->deallocations += (data != NULL);
+  return realloc (data, size);
+}
+
+static void
+check_deallocate (void *user, void *data)
+{
+  ((check_counter *) user)->deallocations++;
+  free (data);
+}
+
+/**
+ * t-complexity of 'data' on a default object (C library, own workspace)
+ */
+static double
+check_reference (char *data, size_t length)
+{
+  flott_object *op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  double t_complexity = -1.0;
+
+  if (flott_initialize (op) == FLOTT_SUCCESS)
+    {
+      flott_t_transform (op);
+      t_complexity = op->result.t_complexity;
+    }
+  flott_destroy (op);
+  return t_complexity;
+}
+
+static void
+check_stream (char *data, size_t length)
+{
+  check_counter counter = { 0, 0 };
+  flott_allocator allocator = { &check_allocate, &check_reallocate,
+                                &check_deallocate, &counter };
+  flott_workspace workspace = { NULL, 0, FLOTT_BACKING_NONE, &allocator };
+  flott_object *op = flott_create_instance_with (1, &allocator);
+  size_t i, offset, input_length, first = 0;
+  unsigned int state = 3;
+  double expected;
+
+  memset (op->input.source, 0, sizeof (flott_source));
+  op->input.source[0].storage_type = FLOTT_DEV_MEM;
+  op->input.deallocate = true; ///< source and sequence lists
+  check_M (flott_workspace_reserve (&workspace, CHECK_MAX_LENGTH,
+                                    FLOTT_SYMBOL_BYTE) == FLOTT_SUCCESS,
+           "workspace reservation failed");
+  check_M (workspace.backing == FLOTT_BACKING_ALLOCATOR,
+           "workspace not taken from the allocator");
+
+  for (i = 0; i < CHECK_INPUTS; i++)
+    {
+      state = state * 1103515245u + 12345u;
+      input_length = 1 + (state >> 8) % CHECK_MAX_LENGTH;
+      offset = (state >> 4) % (length - input_length);
+      op->input.source[0].data.bytes = data + offset;
+      op->input.source[0].length = input_length;
+
+      flott_use_workspace (op, &workspace);
+      check_M (flott_initialize (op) == FLOTT_SUCCESS,
+               "input %zu: initialization failed", i);
+      flott_t_transform (op);
+      if (i % 20 == 0)
+        {
+          expected = check_reference (data + offset, input_length);
+          check_M (fabs (op->result.t_complexity - expected)
+                   <= 1e-12 * expected,
+                   "input %zu: t-complexity %.17g, expected %.17g", i,
+                   op->result.t_complexity, expected);
+        }
+      flott_deinitialize (op);
+      if (i == 0)
+        {
+          first = counter.allocations;
+        }
+    }
+  check_M (counter.allocations == first,
+           "%zu allocations after the first input",
+           counter.allocations - first);
+
+  flott_destroy (op);
+  flott_workspace_release (&workspace);
+  check_M (counter.allocations == counter.deallocations,
+           "%zu allocations, %zu released", counter.allocations,
+           counter.deallocations);
+}
+
+/**
+ * inputs long enough for four initialization threads: the chunk state of
+ * the first input is kept for the following ones
+ */
+static void
+check_parallel_stream (void)
+{
+  size_t length = 5 * FLOTT_INIT_CHUNK_MIN;
+  size_t input_length = 4 * FLOTT_INIT_CHUNK_MIN;
+  char *data = fixture_make_input (length, 13);
+  check_counter counter = { 0, 0 };
+  flott_allocator allocator = { &check_allocate, &check_reallocate,
+                                &check_deallocate, &counter };
+  flott_workspace workspace = { NULL, 0, FLOTT_BACKING_NONE, &allocator };
+  flott_object *op = flott_create_instance_with (1, &allocator);
+  size_t i, first = 0;
+
+  memset (op->input.source, 0, sizeof (flott_source));
+  op->input.source[0].storage_type = FLOTT_DEV_MEM;
+  op->input.deallocate = true;
+  op->thread_count = 4;
+  check_M (flott_workspace_reserve (&workspace, length - 1,
+                                    FLOTT_SYMBOL_BYTE) == FLOTT_SUCCESS,
+           "parallel: workspace reservation failed");
+
+  for (i = 0; i < 4; i++)
+    {
+      op->input.source[0].data.bytes = data + i * 300007;
+      op->input.source[0].length = input_length + i * 1000;
+      flott_use_workspace (op, &workspace);
+      check_M (flott_initialize (op) == FLOTT_SUCCESS,
+               "parallel: input %zu: initialization failed", i);
+      flott_deinitialize (op);
+      if (i == 0)
+        {
+          first = counter.allocations;
+        }
+    }
+  check_M (counter.allocations == first,
+           "parallel: %zu allocations after the first input",
+           counter.allocations - first);
+
+  flott_destroy (op);
+  flott_workspace_release (&workspace);
+  check_M (counter.allocations == counter.deallocations,
+           "parallel: %zu allocations, %zu released", counter.allocations,
+           counter.deallocations);
+  free (data);
+}
+
+static void
+check_scratch (char *data, size_t length)
+{
+  const char *directory = getenv ("TMPDIR");
+  check_counter counter = { 0, 0 };
+  flott_allocator allocator = { &check_allocate, &check_reallocate,
+                                &check_deallocate, &counter };
+  flott_object *op = flott_create_instance_with (1, &allocator);
+  size_t allocations, deallocations;
+  double expected = check_reference (data, length);
+  int run;
+
+  memset (op->input.source, 0, sizeof (flott_source));
+  op->input.source[0].storage_type = FLOTT_DEV_MEM;
+  op->input.source[0].data.bytes = data;
+  op->input.source[0].length = length;
+  op->input.deallocate = true;
+  op->scratch.path = (directory != NULL) ? directory : "/tmp";
+  op->scratch.threshold = 0;
+
+  /* the sequence list of the first run is kept, later runs allocate just
+     the scratch file name */
+  for (run = 0; run < 2; run++)
+    {
+      allocations = counter.allocations;
+      deallocations = counter.deallocations;
+      check_M (flott_initialize (op) == FLOTT_SUCCESS,
+               "scratch: initialization failed");
+      check_M (flott_get_workspace_backing (op) == FLOTT_BACKING_SCRATCH,
+               "scratch: workspace not on a scratch file");
+      flott_t_transform (op);
+      check_M (fabs (op->result.t_complexity - expected) <= 1e-12 * expected,
+               "scratch: t-complexity %.17g, expected %.17g",
+               op->result.t_complexity, expected);
+      flott_deinitialize (op);
+      if (run == 1)
+        {
+          check_M (counter.allocations - allocations == 1
+                   && counter.deallocations - deallocations == 1,
+                   "scratch: %zu allocations, %zu released per input",
+                   counter.allocations - allocations,
+                   counter.deallocations - deallocations);
+        }
+    }
+
+  flott_destroy (op);
+  check_M (counter.allocations == counter.deallocations,
+           "scratch: %zu allocations, %zu released", counter.allocations,
+           counter.deallocations);
+}
+
+int
+main (void)
+{
+  size_t length = 4 * CHECK_MAX_LENGTH;
+  char *data = fixture_make_input (length, 11);
+
+  check_stream (data, length);
+  check_parallel_stream ();
+  check_scratch (data, 100000);
+
+  free (data);
+  return check_report ("allocator and reused workspace");
+}
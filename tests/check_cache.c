@@ -0,0 +1,151 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * result cache check: cached results equal computed ones, caches closed one
+ * after the other on the same file keep each other's results, the file is
+ * replaced rather than rewritten, another cache file keys the same input
+ * differently, and all memory comes from the allocator
+ */
+
+#include "check.h"
+#include "../flott_cache.h"
+
+static size_t allocations_G = 0;
+static size_t deallocations_G = 0;
+
+static void *
+check_allocate (void *user, size_t size)
+{
+  (void) user;
+  allocations_G++;
+  return malloc (size);
+}
+
+static void *
+check_reallocate (void *user, void *data, size_t size)
+{
+  (void) user;
+  if (data == NULL) allocations_G++;
+  return realloc (data, size);
+}
+
+static void
+check_deallocate (void *user, void *data)
+{
+  (void) user;
+  if (data != NULL) deallocations_G++;
+  free (data);
+}
+
+/**
+ * t-transform 'data' through 'cache', returns the t-complexity
+ */
+static double
+check_cached (flott_cache *cache, char *data, size_t length)
+{
+  flott_object *op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  double t_complexity;
+
+  op->cache = cache;
+  check_M (flott_t_transform_cached (op, FLOTT_OBSERVE_NONE) == FLOTT_SUCCESS,
+           "cached transform failed");
+  t_complexity = op->result.t_complexity;
+  flott_destroy (op);
+  return t_complexity;
+}
+
+int
+main (void)
+{
+  flott_allocator allocator = { &check_allocate, &check_reallocate,
+                                &check_deallocate, NULL };
+  char *data[3], *path = fixture_make_file ("", 0);
+  char *other_path = fixture_make_file ("", 0);
+  char *temp_path = (char *) malloc (strlen (path) + sizeof (".lock"));
+  double expected[3];
+  flott_cache *first, *second;
+  flott_cache_key key, other_key;
+  flott_object *op;
+  size_t i, length = 5000;
+
+  for (i = 0; i < 3; i++)
+    {
+      data[i] = fixture_make_input (length, (unsigned int) (21 + i));
+    }
+
+  /* two caches opened on the same (empty) file */
+  check_M (flott_cache_open (path, 16, &allocator, &first) == FLOTT_SUCCESS
+           && flott_cache_open (path, 16, &allocator, &second)
+              == FLOTT_SUCCESS, "cache open failed");
+  expected[0] = check_cached (first, data[0], length);
+  expected[1] = check_cached (second, data[1], length);
+  expected[2] = check_cached (second, data[2], length);
+  check_M (flott_cache_close (first) == FLOTT_SUCCESS
+           && flott_cache_close (second) == FLOTT_SUCCESS,
+           "cache close failed");
+  check_M (allocations_G > 0 && allocations_G == deallocations_G,
+           "%zu allocations, %zu deallocations", allocations_G,
+           deallocations_G);
+  sprintf (temp_path, "%s.tmp", path);
+  check_M (access (temp_path, F_OK) != 0, "temporary cache file left behind");
+
+  /* both caches' results are in the file, and equal the computed ones */
+  check_M (flott_cache_open (path, 16, &allocator, &first) == FLOTT_SUCCESS,
+           "cache reopen failed");
+  for (i = 0; i < 3; i++)
+    {
+      flott_result result;
+
+      op = fixture_make_object (FLOTT_DEV_MEM, data[i], length, NULL);
+      check_M (flott_cache_key_input (first, op, &key) == FLOTT_SUCCESS
+               && flott_cache_lookup (first, &key, &result) == true
+               && result.t_complexity == expected[i],
+               "result %zu missing from the merged cache file", i);
+      flott_destroy (op);
+    }
+
+  /* each cache file has its own secret */
+  check_M (flott_cache_open (other_path, 16, &allocator, &second)
+           == FLOTT_SUCCESS, "second cache file open failed");
+  op = fixture_make_object (FLOTT_DEV_MEM, data[0], length, NULL);
+  check_M (flott_cache_key_input (first, op, &key) == FLOTT_SUCCESS
+           && flott_cache_key_input (second, op, &other_key) == FLOTT_SUCCESS
+           && key.hash[0] != other_key.hash[0]
+           && key.hash[1] != other_key.hash[1],
+           "cache files share their key");
+  flott_destroy (op);
+  check_M (flott_cache_close (second) == FLOTT_SUCCESS
+           && flott_cache_close (first) == FLOTT_SUCCESS,
+           "cache close failed");
+
+  sprintf (temp_path, "%s.lock", path);
+  unlink (temp_path);
+  unlink (path);
+  sprintf (temp_path, "%s.lock", other_path);
+  unlink (temp_path);
+  unlink (other_path);
+  free (temp_path);
+  free (other_path);
+  free (path);
+  for (i = 0; i < 3; i++)
+    {
+      free (data[i]);
+    }
+  return check_report ("result cache");
+}
@@ -0,0 +1,567 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * engine and backing regression check: every token offset width, storage
+ * type, workspace backing and observer policy has to reproduce the results
+ * of the baseline path (memory source, narrowest engine, plain transform)
+ */
+
+#include <math.h>
+
+#include "check.h"
+#include "../flott_short.h"
+
+extern void flott_t_transform_simple (flott_object *op);
+
+typedef struct check_result check_result;
+
+struct check_result
+{
+  double t_complexity;
+  size_t levels;
+  size_t cf_histogram[FLOTT_CF_HISTOGRAM_SIZE];
+};
+
+typedef struct check_reader_state check_reader_state;
+
+struct check_reader_state
+{
+  const char *data;
+  size_t length;
+  size_t position;
+};
+
+enum check_variant
+{
+  CHECK_PLAIN,            ///< 'flott_t_transform_simple'
+  CHECK_OBSERVED,         ///< 'flott_t_transform' with a progress handler
+  CHECK_CALLBACK          ///< 'flott_t_transform_callback'
+};
+
+typedef struct check_step_state check_step_state;
+
+struct check_step_state
+{
+  size_t steps;
+  size_t records;
+  size_t mismatches;
+  const flott_profile_point *point;
+};
+
+static void
+check_step (flott_object *op, void *cp_last, const size_t level,
+            const size_t copy_factor, const size_t cp_offset,
+            const size_t cp_length, const size_t joined_length,
+            const double t_complexity, int *terminate)
+{
+  check_step_state *state = (check_step_state *) op->user;
+
+  (void) cp_last;
+  (void) level;
+  (void) copy_factor;
+  (void) cp_length;
+  (void) joined_length;
+  (void) terminate;
+  if (state->point[state->steps].offset != cp_offset
+      || state->point[state->steps].t_complexity != t_complexity)
+    {
+      state->mismatches++;
+    }
+  state->steps++;
+}
+
+static void
+check_record (flott_object *op, const flott_step_record *record,
+              const size_t count, int *terminate)
+{
+  (void) record;
+  (void) terminate;
+  ((check_step_state *) op->user)->records += count;
+}
+
+static void
+check_last_step (flott_object *op, void *cp_last, const size_t level,
+                 const size_t copy_factor, const size_t cp_offset,
+                 const size_t cp_length, const size_t joined_length,
+                 const double t_complexity, int *terminate)
+{
+  (void) cp_last;
+  (void) level;
+  (void) copy_factor;
+  (void) cp_offset;
+  (void) cp_length;
+  (void) joined_length;
+  (void) terminate;
+  *((double *) op->user) = t_complexity;
+}
+
+/**
+ * write every copy pattern through 'flott_input_write' to 'op->user'
+ */
+static void
+check_write_step (flott_object *op, void *cp_last, const size_t level,
+                  const size_t copy_factor, const size_t cp_offset,
+                  const size_t cp_length, const size_t joined_length,
+                  const double t_complexity, int *terminate)
+{
+  (void) cp_last;
+  (void) level;
+  (void) copy_factor;
+  (void) joined_length;
+  (void) t_complexity;
+  (void) terminate;
+  flott_input_write (op, cp_offset, cp_length, (FILE *) op->user);
+}
+
+static void
+check_progress (const flott_object *op, const float fraction)
+{
+  (void) op;
+  (void) fraction;
+}
+
+static size_t
+check_read (void *user, char *buffer, size_t capacity)
+{
+  check_reader_state *state = (check_reader_state *) user;
+  size_t count = state->length - state->position;
+
+  count = (count < capacity) ? count : capacity;
+  memcpy (buffer, state->data + state->position, count);
+  state->position += count;
+  return count;
+}
+
+static size_t
+check_pread (void *user, char *buffer, size_t count, size_t offset)
+{
+  check_reader_state *state = (check_reader_state *) user;
+
+  if (offset >= state->length) return 0;
+  count = (count < state->length - offset) ? count : state->length - offset;
+  memcpy (buffer, state->data + offset, count);
+  return count;
+}
+
+static void *
+check_allocate (void *user, size_t size)
+{
+  (void) user;
+  return malloc (size);
+}
+
+static void *
+check_reallocate (void *user, void *data, size_t size)
+{
+  (void) user;
+  return realloc (data, size);
+}
+
+static void
+check_deallocate (void *user, void *data)
+{
+  (void) user;
+  free (data);
+}
+
+/**
+ * initialize and transform 'op', then destroy it
+ */
+static check_result
+check_run (flott_object *op, enum check_variant variant, const char *name)
+{
+  check_result result;
+
+  memset (&result, 0, sizeof (result));
+  if (flott_initialize (op) != FLOTT_SUCCESS)
+    {
+      check_M (0, "%s: initialization failed", name);
+      flott_destroy (op);
+      return result;
+    }
+
+  switch (variant)
+    {
+      case CHECK_OBSERVED :
+        op->handler.progress = &check_progress;
+        flott_t_transform (op);
+        break;
+      case CHECK_CALLBACK : flott_t_transform_callback (op); break;
+      default : flott_t_transform_simple (op); break;
+    }
+
+  result.t_complexity = op->result.t_complexity;
+  result.levels = op->result.levels;
+  memcpy (result.cf_histogram, op->result.cf_histogram,
+          sizeof (result.cf_histogram));
+  flott_deinitialize (op);
+  flott_destroy (op);
+  return result;
+}
+
+static void
+check_same (const check_result *expected, const check_result *actual,
+            size_t length, const char *name)
+{
+  check_M (expected->t_complexity == actual->t_complexity
+           && expected->levels == actual->levels
+           && memcmp (expected->cf_histogram, actual->cf_histogram,
+                      sizeof (expected->cf_histogram)) == 0,
+           "%s (%zu bytes): t-complexity %.6f/%zu levels, expected %.6f/%zu",
+           name, length, actual->t_complexity, actual->levels,
+           expected->t_complexity, expected->levels);
+}
+
+static void
+check_input (size_t length, unsigned int seed)
+{
+  flott_allocator allocator = { &check_allocate, &check_reallocate,
+                                &check_deallocate, NULL };
+  flott_reader reader = { &check_read, &check_pread };
+  flott_reader single_pass = { &check_read, NULL };
+  check_reader_state state;
+  flott_workspace workspace = { NULL, 0, FLOTT_BACKING_NONE, NULL };
+  flott_offset_type width[] = { FLOTT_OFFSET_32BIT, FLOTT_OFFSET_64BIT };
+  flott_storage_type storage[] = { FLOTT_DEV_FILE, FLOTT_DEV_FILE_TO_MEM,
+                                   FLOTT_DEV_MMAP, FLOTT_DEV_STREAM };
+  const char *storage_name[] = { "file", "file to memory", "mmap", "stream" };
+  const char *directory = getenv ("TMPDIR");
+  char *data = fixture_make_input (length, seed);
+  char *path = fixture_make_file (data, length);
+  check_result expected, actual;
+  flott_object *op;
+  flott_short_input short_input;
+  double t_complexity;
+  void *block;
+  size_t i;
+
+  /* baseline path */
+  expected = check_run (fixture_make_object (FLOTT_DEV_MEM, data, length,
+                                             NULL), CHECK_PLAIN, "baseline");
+
+  /* token offset widths, 8-bit and 1-bit symbols */
+  for (i = 0; i < sizeof (width) / sizeof (width[0]); i++)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      op->input.offset_type = width[i];
+      actual = check_run (op, CHECK_PLAIN, "width");
+      check_same (&expected, &actual, length, (i == 0) ? "32-bit engine"
+                                                        : "64-bit engine");
+    }
+  if (length <= 8192)
+    {
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      op->input.symbol_type = FLOTT_SYMBOL_BIT;
+      expected = check_run (op, CHECK_PLAIN, "bits");
+      for (i = 0; i < sizeof (width) / sizeof (width[0]); i++)
+        {
+          op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+          op->input.symbol_type = FLOTT_SYMBOL_BIT;
+          op->input.offset_type = width[i];
+          actual = check_run (op, CHECK_PLAIN, "bits width");
+          check_same (&expected, &actual, length, "1-bit symbols, wider engine");
+        }
+      expected = check_run (fixture_make_object (FLOTT_DEV_MEM, data, length,
+                                                 NULL), CHECK_PLAIN,
+                            "baseline");
+    }
+
+  /* observer policies */
+  actual = check_run (fixture_make_object (FLOTT_DEV_MEM, data, length,
+                                           NULL), CHECK_OBSERVED, "observed");
+  check_same (&expected, &actual, length, "progress observer");
+  actual = check_run (fixture_make_object (FLOTT_DEV_MEM, data, length,
+                                           NULL), CHECK_CALLBACK, "callback");
+  check_same (&expected, &actual, length, "callback policy");
+
+  /* step handler, step records and profile observed together */
+  if (length > 1)
+    {
+      flott_step_record records[16];
+      check_step_state steps;
+
+      memset (&steps, 0, sizeof (steps));
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      flott_initialize (op);
+      op->user = &steps;
+      op->profile.size = op->_private.token_list.length;
+      op->profile.point = (flott_profile_point *)
+          malloc (op->profile.size * sizeof (flott_profile_point));
+      steps.point = op->profile.point;
+      op->handler.step = &check_step;
+      op->handler.record = &check_record;
+      op->step_buffer.record = records;
+      op->step_buffer.size = 16;
+      flott_t_transform (op);
+      check_M (op->profile.count > 0 && steps.steps == op->profile.count
+               && steps.records == op->profile.count && steps.mismatches == 0
+               && op->result.t_complexity == expected.t_complexity,
+               "%zu bytes: %zu profile points, %zu steps, %zu records,"
+               " %zu mismatches", length, op->profile.count, steps.steps,
+               steps.records, steps.mismatches);
+      free (op->profile.point);
+      flott_destroy (op);
+    }
+
+  /* storage types */
+  for (i = 0; i < sizeof (storage) / sizeof (storage[0]); i++)
+    {
+      actual = check_run (fixture_make_object (storage[i], data, length,
+                                               path), CHECK_PLAIN,
+                          storage_name[i]);
+      check_same (&expected, &actual, length, storage_name[i]);
+    }
+  state.data = data;
+  state.length = length;
+  state.position = 0;
+  op = fixture_make_object (FLOTT_DEV_CALLBACK, data, length, NULL);
+  op->input.source[0].data.reader = &reader;
+  op->input.source[0].user = &state;
+  actual = check_run (op, CHECK_PLAIN, "callback source");
+  check_same (&expected, &actual, length, "callback source (pread)");
+  state.position = 0;
+  op = fixture_make_object (FLOTT_DEV_CALLBACK, data, length, NULL);
+  op->input.source[0].data.reader = &single_pass;
+  op->input.source[0].user = &state;
+  actual = check_run (op, CHECK_PLAIN, "callback source");
+  check_same (&expected, &actual, length, "callback source (read)");
+
+  /* workspace backings */
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  block = malloc (flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE));
+  flott_set_workspace (op, block, flott_get_workspace_size (length,
+                                                            FLOTT_SYMBOL_BYTE));
+  actual = check_run (op, CHECK_PLAIN, "heap");
+  free (block);
+  check_same (&expected, &actual, length, "plain heap workspace");
+
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  op->allocator = &allocator;
+  actual = check_run (op, CHECK_PLAIN, "allocator");
+  check_same (&expected, &actual, length, "allocator workspace");
+
+  flott_workspace_reserve (&workspace, length, FLOTT_SYMBOL_BYTE);
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  flott_use_workspace (op, &workspace);
+  actual = check_run (op, CHECK_PLAIN, "reserved");
+  flott_workspace_release (&workspace);
+  check_same (&expected, &actual, length, "reserved workspace");
+
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  op->scratch.path = (directory != NULL) ? directory : "/tmp";
+  actual = check_run (op, CHECK_PLAIN, "scratch");
+  check_same (&expected, &actual, length, "scratch file workspace");
+
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  if (flott_initialize (op) == FLOTT_SUCCESS
+      && flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE)
+         >= FLOTT_HUGE_PAGE_MIN)
+    {
+      check_M (flott_get_workspace_backing (op) != FLOTT_BACKING_HEAP,
+               "%zu bytes: large workspace not page backed", length);
+    }
+  flott_destroy (op);
+
+  /* short string batch */
+  if (length <= FLOTT_SHORT_MAX_LENGTH)
+    {
+      short_input.bytes = data;
+      short_input.length = length;
+      check_M (flott_short_batch (NULL, &short_input, 1, NULL, 0,
+                                  &t_complexity, NULL) == FLOTT_SUCCESS
+               && t_complexity == expected.t_complexity,
+               "short batch (%zu bytes): t-complexity %.6f, expected %.6f",
+               length, t_complexity, expected.t_complexity);
+    }
+
+  unlink (path);
+  free (path);
+  free (data);
+}
+
+/**
+ * runs of one symbol produce copy factors well past the dense histogram,
+ * with more distinct values than the overflow tail holds; the histogram
+ * has to account for every step and its sum has to match the running sum
+ */
+static void
+check_copy_factors (void)
+{
+  size_t run, i, length = 0, steps = 0;
+  char *data = (char *) malloc (100 * FLOTT_CF_HISTOGRAM_SIZE + 100 * 101);
+  double cumulative = 0.0;
+  flott_object *op;
+
+  for (run = 1; run <= 100; run++)
+    {
+      for (i = 0; i < FLOTT_CF_HISTOGRAM_SIZE + run; i++)
+        {
+          data[length++] = (char) (run + 32);
+        }
+    }
+
+  op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  flott_initialize (op);
+  op->user = &cumulative;
+  op->handler.step = &check_last_step;
+  flott_t_transform (op);
+  for (i = 0; i < FLOTT_CF_HISTOGRAM_SIZE; i++)
+    {
+      steps += op->result.cf_histogram[i];
+    }
+  check_M (op->result.cf_histogram[0] > FLOTT_CF_TAIL_SIZE
+           && steps == op->result.levels
+           && fabs (op->result.t_complexity - cumulative)
+              <= 1e-12 * cumulative,
+           "copy factors: %zu overflow steps, %zu of %zu levels,"
+           " t-complexity %.17g, running sum %.17g", op->result.cf_histogram[0],
+           steps, op->result.levels, op->result.t_complexity, cumulative);
+  flott_destroy (op);
+  free (data);
+}
+
+/**
+ * files larger than FLOTT_READ_AHEAD_SIZE are read by a reader thread,
+ * including one that ends exactly on a buffer boundary
+ */
+static void
+check_read_ahead (void)
+{
+  size_t length[] = { 2 * FLOTT_READ_AHEAD_SIZE, 2 * FLOTT_READ_AHEAD_SIZE
+                                                 + 4321 };
+  check_result expected, actual;
+  char *data, *path;
+  size_t i;
+
+  for (i = 0; i < sizeof (length) / sizeof (length[0]); i++)
+    {
+      data = fixture_make_input (length[i], (unsigned int) (31 + i));
+      path = fixture_make_file (data, length[i]);
+      expected = check_run (fixture_make_object (FLOTT_DEV_MEM, data,
+                                                 length[i], NULL),
+                            CHECK_PLAIN, "memory");
+      actual = check_run (fixture_make_object (FLOTT_DEV_FILE, data,
+                                               length[i], path),
+                          CHECK_PLAIN, "read-ahead");
+      check_same (&expected, &actual, length[i], "file read-ahead");
+      unlink (path);
+      free (path);
+      free (data);
+    }
+}
+
+/**
+ * parallel level-zero initialization (four chunks of at least
+ * FLOTT_INIT_CHUNK_MIN symbols, the last one longer) has to leave a token
+ * workspace bit-identical to the serial path
+ */
+static void
+check_parallel_init (void)
+{
+  size_t length = 4 * FLOTT_INIT_CHUNK_MIN + 12345;
+  size_t size = flott_get_workspace_size (length, FLOTT_SYMBOL_BYTE);
+  char *data = fixture_make_input (length, 37);
+  char *workspace = (char *) calloc (size, 1);
+  char *serial = (char *) malloc (size);
+  check_result result[2];
+  flott_object *op;
+  int variant;
+
+  for (variant = 0; variant < 2; variant++)
+    {
+      memset (workspace, 0, size);
+      op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+      op->thread_count = (variant == 0) ? 1 : 4;
+      flott_set_workspace (op, workspace, size);
+      check_M (flott_initialize (op) == FLOTT_SUCCESS,
+               "parallel init: initialization failed");
+      if (variant == 0)
+        {
+          memcpy (serial, workspace, size);
+        }
+      else
+        {
+          check_M (memcmp (serial, workspace, size) == 0,
+                   "parallel init: workspace differs from the serial path");
+        }
+      flott_t_transform_simple (op);
+      result[variant].t_complexity = op->result.t_complexity;
+      result[variant].levels = op->result.levels;
+      memcpy (result[variant].cf_histogram, op->result.cf_histogram,
+              sizeof (result[variant].cf_histogram));
+      flott_destroy (op);
+    }
+  check_same (&result[0], &result[1], length, "parallel init");
+
+  free (serial);
+  free (workspace);
+  free (data);
+}
+
+/**
+ * re-initializing an object must not leak the handles its copy pattern
+ * writes opened on file sources
+ */
+static void
+check_reinitialize (void)
+{
+  size_t length = 20000;
+  char *data = fixture_make_input (length, 41);
+  char *path = fixture_make_file (data, length);
+  FILE *sink = fopen ("/dev/null", "wb");
+  flott_object *op = fixture_make_object (FLOTT_DEV_FILE, data, length, path);
+  int fd = check_free_descriptor (), first = 0, run;
+
+  op->user = sink;
+  op->handler.step = &check_write_step;
+  for (run = 0; run < 5; run++)
+    {
+      check_M (flott_initialize (op) == FLOTT_SUCCESS,
+               "re-initialization %d failed", run);
+      flott_t_transform (op);
+      first = (run == 0) ? check_free_descriptor () : first;
+    }
+  check_M (check_free_descriptor () == first,
+           "re-initialization: descriptor %d after five runs, %d after one",
+           check_free_descriptor (), first);
+  flott_destroy (op);
+  check_M (check_free_descriptor () == fd,
+           "re-initialization: file handle left open after destroy");
+
+  fclose (sink);
+  unlink (path);
+  free (path);
+  free (data);
+}
+
+int
+main (void)
+{
+  check_input (1, 1);
+  check_input (4000, 2);
+  check_input (60000, 3);         ///< largest 16-bit inputs
+  check_input (300000, 4);        ///< 32-bit engine
+  check_input (600000, 5);        ///< huge page backed workspace
+  check_copy_factors ();
+  check_read_ahead ();
+  check_parallel_init ();
+  check_reinitialize ();
+
+  return check_report ("engines and backings");
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * distance matrix check: every entry has to equal the distance of the pair
+ * computed by 'flott_nti_dist'/'flott_ntc_dist', single and multi-threaded,
+ * and the binary matrix file has to decode as little-endian
+ */
+
+#include <math.h>
+
+#include "check.h"
+#include "../flott_nid.h"
+
+#define CHECK_INPUTS 5
+
+static double
+check_pair (flott_matrix_type type, char **data, size_t *length, size_t a,
+            size_t b)
+{
+  flott_object *op = flott_create_instance (3);
+  double distance = -1.0;
+
+  memset (op->input.source, 0, 3 * sizeof (flott_source));
+  op->input.source[0].storage_type = FLOTT_DEV_MEM;
+  op->input.source[0].data.bytes = data[a];
+  op->input.source[0].length = length[a];
+  op->input.source[1].storage_type = FLOTT_DEV_MEM;
+  op->input.source[1].data.bytes = data[b];
+  op->input.source[1].length = length[b];
+  if (type == FLOTT_MATRIX_NTI)
+    {
+      op->input.count = 2;
+      flott_nti_dist (op, &distance);
+      op->input.count = 3;
+    }
+  else
+    {
+      op->input.append_termchar = true;
+      flott_ntc_dist (op, &distance);
+    }
+  flott_destroy (op);
+  return distance;
+}
+
+static flott_uint64
+check_load_le (const unsigned char *buffer, int size)
+{
+  flott_uint64 value = 0;
+
+  while (size-- > 0)
+    {
+      value = (value << 8) | buffer[size];
+    }
+  return value;
+}
+
+static void
+check_binary (flott_matrix_type type, const double *matrix, size_t count)
+{
+  unsigned char buffer[FLOTT_MATRIX_HDRSZ + 8 * CHECK_INPUTS * CHECK_INPUTS];
+  size_t size = FLOTT_MATRIX_HDRSZ + 8 * count * count;
+  FILE *handle = tmpfile ();
+  flott_uint64 bits;
+  double value;
+  size_t i;
+
+  check_M (handle != NULL
+           && flott_matrix_write (handle, FLOTT_MATRIX_BINARY, type, matrix,
+                                  count, NULL, 0) == FLOTT_SUCCESS,
+           "binary matrix write failed");
+  if (handle == NULL) return;
+  rewind (handle);
+  check_M (fread (buffer, 1, sizeof (buffer), handle) == size,
+           "binary matrix: expected %zu bytes", size);
+  check_M (memcmp (buffer, FLOTT_MATRIX_MAGIC, 8) == 0
+           && check_load_le (&buffer[8], 4) == FLOTT_MATRIX_VERSION
+           && check_load_le (&buffer[12], 4) == (flott_uint64) type
+           && check_load_le (&buffer[16], 8) == count,
+           "binary matrix: bad header");
+  for (i = 0; i < count * count; i++)
+    {
+      bits = check_load_le (&buffer[FLOTT_MATRIX_HDRSZ + 8 * i], 8);
+      memcpy (&value, &bits, 8);
+      check_M (value == matrix[i], "binary matrix: entry %zu differs", i);
+    }
+  fclose (handle);
+}
+
+int
+main (void)
+{
+  flott_matrix_type type[] = { FLOTT_MATRIX_NTI, FLOTT_MATRIX_NTC };
+  /* ntc: C(j) of the matrix sums j's steps in another order than the
+     boundary capture of 'flott_ntc_dist', the last bits may differ */
+  double tolerance[] = { 0.0, 1e-12 };
+  double distance;
+  char *data[CHECK_INPUTS];
+  size_t length[CHECK_INPUTS];
+  double matrix[CHECK_INPUTS * CHECK_INPUTS];
+  flott_object *op;
+  size_t i, j, t, threads;
+
+  for (i = 0; i < CHECK_INPUTS; i++)
+    {
+      length[i] = 2000 + 1500 * i;
+      data[i] = fixture_make_input (length[i], (unsigned int) (11 + i % 3));
+    }
+
+  for (t = 0; t < 2; t++)
+    {
+      for (threads = 1; threads <= 3; threads += 2)
+        {
+          op = flott_create_instance (CHECK_INPUTS);
+          memset (op->input.source, 0, CHECK_INPUTS * sizeof (flott_source));
+          for (i = 0; i < CHECK_INPUTS; i++)
+            {
+              op->input.source[i].storage_type = FLOTT_DEV_MEM;
+              op->input.source[i].data.bytes = data[i];
+              op->input.source[i].length = length[i];
+            }
+          op->input.append_termchar = (type[t] == FLOTT_MATRIX_NTC);
+          check_M (flott_matrix (op, type[t], threads, matrix)
+                   == FLOTT_SUCCESS, "matrix failed");
+          flott_destroy (op);
+
+          for (i = 0; i < CHECK_INPUTS; i++)
+            {
+              for (j = 0; j < CHECK_INPUTS; j++)
+                {
+                  distance = check_pair (type[t], data, length, i, j);
+                  check_M (fabs (matrix[i * CHECK_INPUTS + j] - distance)
+                           <= tolerance[t],
+                           "%s matrix (%zu threads): entry (%zu, %zu) is %.17g,"
+                           " expected %.17g", (t == 0) ? "nti" : "ntc",
+                           threads, i, j, matrix[i * CHECK_INPUTS + j],
+                           distance);
+                }
+            }
+        }
+      check_binary (type[t], matrix, CHECK_INPUTS);
+    }
+
+  for (i = 0; i < CHECK_INPUTS; i++)
+    {
+      free (data[i]);
+    }
+  return check_report ("distance matrix");
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * sliding window check: every window result has to match a separate run on
+ * the window bytes, for every storage type and for windows spanning two
+ * sources; sources opened by the window run must be released again
+ */
+
+#include "check.h"
+
+#define CHECK_MAX_WINDOWS 64
+
+extern void flott_t_transform_simple (flott_object *op);
+
+typedef struct check_window_state check_window_state;
+
+struct check_window_state
+{
+  size_t count;
+  size_t offset[CHECK_MAX_WINDOWS];
+  double t_complexity[CHECK_MAX_WINDOWS];
+};
+
+static void
+check_window (flott_object *op, const size_t offset,
+              const flott_result *result, int *terminate)
+{
+  check_window_state *state = (check_window_state *) op->user;
+
+  if (state->count < CHECK_MAX_WINDOWS)
+    {
+      state->offset[state->count] = offset;
+      state->t_complexity[state->count] = result->t_complexity;
+      state->count++;
+    }
+  *terminate = (state->count >= CHECK_MAX_WINDOWS);
+}
+
+static double
+check_separate_run (char *data, size_t length)
+{
+  flott_object *op = fixture_make_object (FLOTT_DEV_MEM, data, length, NULL);
+  double t_complexity;
+
+  flott_initialize (op);
+  flott_t_transform_simple (op);
+  t_complexity = op->result.t_complexity;
+  flott_destroy (op);
+  return t_complexity;
+}
+
+static void
+check_windows (flott_object *op, char *data, size_t size, size_t stride,
+               const char *name)
+{
+  check_window_state state;
+  size_t i;
+  int fd = check_free_descriptor ();
+
+  memset (&state, 0, sizeof (state));
+  op->user = &state;
+  op->window.size = size;
+  op->window.stride = stride;
+  op->handler.window = &check_window;
+  check_M (flott_t_transform_window (op) == FLOTT_SUCCESS,
+           "%s: window run failed", name);
+  check_M (state.count > 1, "%s: %zu windows", name, state.count);
+  for (i = 0; i < state.count; i++)
+    {
+      check_M (state.t_complexity[i]
+               == check_separate_run (data + state.offset[i], size),
+               "%s: window at %zu differs from a separate run", name,
+               state.offset[i]);
+    }
+
+  /* a second run on the same object must not leak or reload */
+  state.count = 0;
+  check_M (flott_t_transform_window (op) == FLOTT_SUCCESS && state.count > 1,
+           "%s: second window run failed", name);
+  check_M (check_free_descriptor () == fd, "%s: file handle left open", name);
+  for (i = 0; i < op->input.count; i++)
+    {
+      if (op->input.source[i].storage_type != FLOTT_DEV_MEM)
+        {
+          check_M (op->input.source[i].data.bytes == NULL,
+                   "%s: source %zu left loaded or mapped", name, i);
+        }
+    }
+  flott_destroy (op);
+}
+
+int
+main (void)
+{
+  flott_storage_type storage[] = { FLOTT_DEV_MEM, FLOTT_DEV_FILE,
+                                   FLOTT_DEV_FILE_TO_MEM, FLOTT_DEV_MMAP };
+  const char *storage_name[] = { "memory", "file", "file to memory", "mmap" };
+  size_t length = 200000;
+  char *data = fixture_make_input (length, 7);
+  char *path = fixture_make_file (data, length);
+  char *head = fixture_make_file (data, length / 2);
+  char *tail = fixture_make_file (data + length / 2, length - length / 2);
+  flott_object *op;
+  size_t i;
+
+  for (i = 0; i < sizeof (storage) / sizeof (storage[0]); i++)
+    {
+      check_windows (fixture_make_object (storage[i], data, length, path),
+                     data, 4096, 3000, storage_name[i]);
+    }
+
+  /* windows spanning two file sources are assembled in the window buffer */
+  for (i = 1; i < sizeof (storage) / sizeof (storage[0]); i++)
+    {
+      op = flott_create_instance (2);
+      memset (op->input.source, 0, 2 * sizeof (flott_source));
+      op->input.source[0].storage_type = storage[i];
+      op->input.source[0].path = head;
+      op->input.source[0].length = length / 2;
+      op->input.source[1].storage_type = storage[i];
+      op->input.source[1].path = tail;
+      op->input.source[1].length = length - length / 2;
+      check_windows (op, data, 8192, 7777, storage_name[i]);
+    }
+
+  unlink (tail);
+  unlink (head);
+  unlink (path);
+  free (tail);
+  free (head);
+  free (path);
+  free (data);
+  return check_report ("sliding windows");
+}
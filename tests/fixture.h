@@ -0,0 +1,113 @@
+/*
+ * Copyright 2012 Niko Rebenich and Stephen Neville,
+ *                University of Victoria
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * test inputs shared by the 'make check' and 'make bench' drivers (header
+ * only): reproducible generated text, temporary files and single source
+ * objects
+ */
+
+#ifndef _FLOTT_FIXTURE_H_
+#define _FLOTT_FIXTURE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../flott.h"
+
+/**
+ * text-like input of 'length' bytes: words of a small vocabulary drawn
+ * by a fixed LCG, so that results are reproducible and have long matches
+ */
+static inline char *
+fixture_make_input (size_t length, unsigned int seed)
+{
+  static const char *word[] = { "alpha ", "beta ", "gamma ", "delta\n",
+                                "epsilon ", "zeta ", "eta ", "theta, ",
+                                "iota ", "kappa ", "lambda ", "mu." };
+  char *data = (char *) malloc (length + 1);
+  size_t i = 0, n;
+  unsigned int state = seed;
+
+  while (data != NULL && i < length)
+    {
+      state = state * 1103515245u + 12345u;
+      n = strlen (word[(state >> 16) % 12]);
+      n = (n < length - i) ? n : length - i;
+      memcpy (data + i, word[(state >> 16) % 12], n);
+      i += n;
+      if ((state >> 8) % 7 == 0 && i < length) ///< sprinkle noise
+        {
+          data[i++] = (char) ('A' + (state >> 20) % 26);
+        }
+    }
+  return data;
+}
+
+/**
+ * write 'length' bytes to a new temporary file, returns its path (malloc'd)
+ */
+static inline char *
+fixture_make_file (const char *data, size_t length)
+{
+  const char *directory = getenv ("TMPDIR");
+  char *path;
+  FILE *file;
+  int fd;
+
+  directory = (directory != NULL) ? directory : "/tmp";
+  path = (char *) malloc (strlen (directory) + sizeof ("/flott_test.XXXXXX"));
+  sprintf (path, "%s/flott_test.XXXXXX", directory);
+  fd = mkstemp (path);
+  file = (fd >= 0) ? fdopen (fd, "wb") : NULL;
+  if (file == NULL || fwrite (data, 1, length, file) != length)
+    {
+      fprintf (stderr, "cannot write temporary file %s\n", path);
+      exit (2);
+    }
+  fclose (file);
+  return path;
+}
+
+/**
+ * single source object over 'data' (memory) or 'path' (file storage types)
+ */
+static inline flott_object *
+fixture_make_object (flott_storage_type storage_type, char *data,
+                     size_t length, char *path)
+{
+  flott_object *op = flott_create_instance (1);
+
+  memset (op->input.source, 0, sizeof (flott_source));
+  op->input.source[0].storage_type = storage_type;
+  op->input.source[0].length = length;
+  if (storage_type == FLOTT_DEV_MEM)
+    {
+      op->input.source[0].data.bytes = data;
+    }
+  else
+    {
+      op->input.source[0].path = path;
+    }
+  op->input.deallocate = true; ///< source list, loaded bytes
+  return op;
+}
+
+#endif /* _FLOTT_FIXTURE_H_ */